@@ -1,6 +1,16 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <sstream>
 
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include <boost/random/mersenne_twister.hpp>
@@ -9,20 +19,55 @@
 #include <boost/thread.hpp>
 #include <boost/type_traits/alignment_of.hpp>
 #include <boost/bind.hpp>
+#include <boost/config.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/pool/pool.hpp>
+#include <boost/random/lognormal_distribution.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 #include "obstack.hpp"
+#include "bump_obstack.hpp"
+#include "obstack_trace.hpp"
 #include "max_alignment_type.hpp"
+#ifdef BOOST_ARENA_HAS_NUMA
+#include "numa_allocator.hpp"
+#endif
 
 using namespace boost::posix_time;
 
+//the name of the malloc implementation this benchmark is linked against
+#ifdef BOOST_ARENA_BENCHMARK_MALLOC_NAME
+#define BOOST_ARENA_BENCHMARK_MALLOC BOOST_STRINGIZE(BOOST_ARENA_BENCHMARK_MALLOC_NAME)
+#else
+#define BOOST_ARENA_BENCHMARK_MALLOC "malloc"
+#endif
+
 typedef std::vector<size_t> alloc_order_vec;
 
-static alloc_order_vec make_alloc_sequence(const size_t total_memory, const size_t min_alloc_size, const size_t max_alloc_size) {
+//uniformly distributed allocation sizes
+struct uniform_sizes {
+	uniform_sizes(const size_t min_alloc_size, const size_t max_alloc_size) :
+		dist(min_alloc_size, max_alloc_size)
+	{}
+	size_t operator()(boost::mt19937 &gen) { return dist(gen); }
+	boost::uniform_int<size_t> dist;
+};
+
+//draws sizes from dist until total_memory is allocated
+template<class SizeDistribution>
+static alloc_order_vec make_alloc_sequence(const size_t total_memory, SizeDistribution dist) {
 	boost::mt19937 gen;
 	gen.seed(42);
 	
 	alloc_order_vec out;
-	boost::uniform_int<size_t> dist(min_alloc_size, max_alloc_size);
 
 	size_t mem_sum = 0;
 	while(mem_sum < total_memory) {
@@ -44,26 +89,24 @@ static alloc_order_vec make_alloc_sequence(const size_t total_memory, const size
 	return out;
 }
 
+static alloc_order_vec make_alloc_sequence(const size_t total_memory, const size_t min_alloc_size, const size_t max_alloc_size) {
+	return make_alloc_sequence(total_memory, uniform_sizes(min_alloc_size, max_alloc_size));
+}
+
+//a random permutation of the allocation positions, shuffled with Fisher-Yates
 static alloc_order_vec make_free_sequence(const alloc_order_vec &alloc_seq) {
 	alloc_order_vec out;
 	out.resize(alloc_seq.size());
+	for(size_t i=0; i<out.size(); i++) {
+		out[i] = i;
+	}
 
 	boost::mt19937 gen;
 	gen.seed(42);
 
-	alloc_order_vec positions;
-	positions.resize(alloc_seq.size());
-	for(size_t i=0; i<positions.size(); i++) {
-		positions[i] = i;
-	}
-
-	for(size_t i=0; i<out.size(); i++) {
-		boost::uniform_int<size_t> dist(0, positions.size()-1);
-		const size_t k = dist(gen);
-		
-		out[i] = positions[k];
-
-		positions.erase(positions.begin()+k);
+	for(size_t i=out.size(); i>1; i--) {
+		boost::uniform_int<size_t> dist(0, i-1);
+		std::swap(out[i-1], out[dist(gen)]);
 	}
 
 	return out;
@@ -85,7 +128,10 @@ public:
 	enum benchmark {
 		BENCHMARK_OBSTACK = 0,
 		BENCHMARK_MALLOC_FREE = 1,
-		BENCHMARK_NEW_DELETE = 2
+		BENCHMARK_NEW_DELETE = 2,
+		BENCHMARK_OBSTACK_CHECKSUM_ONLY = 3,
+		BENCHMARK_OBSTACK_UNCHECKED = 4,
+		NUM_BENCHMARKS = 5
 	};
 
 	void account(benchmark which, const time_duration &how_long) {
@@ -101,8 +147,8 @@ public:
 private:
 	size_t to_index(benchmark e) { return static_cast<size_t>(e); }
 	
-	time_duration durations[3];
-	mutex_type mutexes[3];
+	time_duration durations[NUM_BENCHMARKS];
+	mutex_type mutexes[NUM_BENCHMARKS];
 	
 };
 
@@ -172,6 +218,7 @@ static void benchmark_malloc(
 }
 
 
+template<class Obstack, timing_registry::benchmark Which>
 static void benchmark_obstack(
 	boost::barrier &start_allocs,
 	const alloc_order_vec &alloc_seq,
@@ -183,8 +230,8 @@ static void benchmark_obstack(
 	chunks.resize(alloc_seq.size());
 
 	const size_t alloc_sum = sum_vec(alloc_seq);
-	const size_t required_size = alloc_sum + boost::arena::obstack::max_overhead(alloc_seq.size());
-	boost::arena::obstack obs(required_size);
+	const size_t required_size = alloc_sum + Obstack::max_overhead(alloc_seq.size());
+	Obstack obs(required_size);
 	
 	start_allocs.wait();
 	
@@ -194,7 +241,7 @@ static void benchmark_obstack(
 		//1. in order alloc/free
 		for(size_t i=0; i<alloc_seq.size(); i++) {
 			const size_t s = alloc_seq[i];
-			chunks[i] = obs.alloc_array<char>(s);
+			chunks[i] = obs.template alloc_array<char>(s);
 			CHECK_ALLOC(chunks[i]);
 		}
 		for(size_t i=0; i<chunks.size(); i++) {
@@ -205,7 +252,7 @@ static void benchmark_obstack(
 		//2. reverse order malloc/free
 		for(size_t i=0; i<alloc_seq.size(); i++) {
 			const size_t s = alloc_seq[i];
-			chunks[i] = obs.alloc_array<char>(s);
+			chunks[i] = obs.template alloc_array<char>(s);
 			CHECK_ALLOC(chunks[i]);
 		}
 		for(size_t i=0; i<chunks.size(); i++) {
@@ -216,7 +263,7 @@ static void benchmark_obstack(
 		//3. random order malloc/free
 		for(size_t i=0; i<alloc_seq.size(); i++) {
 			const size_t s = alloc_seq[i];
-			chunks[i] = obs.alloc_array<char>(s);
+			chunks[i] = obs.template alloc_array<char>(s);
 			CHECK_ALLOC(chunks[i]);
 		}
 		for(size_t i=0; i<free_seq.size(); i++) {
@@ -227,7 +274,7 @@ static void benchmark_obstack(
 
 	ptime end(microsec_clock::universal_time());
 
-	timings.account(timing_registry::BENCHMARK_OBSTACK, end-start);
+	timings.account(Which, end-start);
 }
 
 static void benchmark_new_delete(
@@ -291,6 +338,50 @@ static void benchmark_new_delete(
 	}
 }
 
+typedef boost::arena::basic_obstack<
+	std::allocator<boost::arena::max_align_t>,
+	boost::arena::null_stats,
+	boost::arena::security::checksum_only
+> checksum_only_obstack;
+
+typedef boost::arena::basic_obstack<
+	std::allocator<boost::arena::max_align_t>,
+	boost::arena::null_stats,
+	boost::arena::security::none
+> unchecked_obstack;
+
+typedef boost::arena::basic_obstack<
+	std::allocator<boost::arena::max_align_t>,
+	boost::arena::null_stats,
+	boost::arena::security::hardened,
+	boost::arena::hole_reuse
+> hole_reuse_obstack;
+
+template<class Obstack, timing_registry::benchmark Which>
+static void benchmark_obstack_threads(
+	const size_t num_threads,
+	const std::vector<alloc_order_vec> &alloc_orders,
+	const std::vector<alloc_order_vec> &free_orders,
+	const size_t per_thread_iterations,
+	timing_registry &timings
+) {
+	boost::thread_group threads;
+	boost::barrier start_allocs(num_threads);
+	for(size_t i=0; i<num_threads; i++) {
+		threads.create_thread(
+			boost::bind(
+				&benchmark_obstack<Obstack, Which>,
+				boost::ref(start_allocs),
+				boost::cref(alloc_orders[i]),
+				boost::cref(free_orders[i]),
+				per_thread_iterations,
+				boost::ref(timings)
+			)
+		);
+	}
+	threads.join_all();
+}
+
 static void benchmark_threaded(
 	const size_t num_threads,
 	const size_t total_memory,
@@ -363,24 +454,13 @@ static void benchmark_threaded(
 		threads.join_all();
 	}
 
-	//obstack
-	{
-		boost::thread_group threads;
-		boost::barrier start_allocs(num_threads);
-		for(size_t i=0; i<num_threads; i++) {
-			threads.create_thread(
-				boost::bind(
-					benchmark_obstack,
-					boost::ref(start_allocs),
-					boost::ref(alloc_orders[i]),
-					boost::ref(free_orders[i]),
-					per_thread_iterations,
-					boost::ref(timings)
-				)
-			);
-		}
-		threads.join_all();
-	}
+	//obstack with the different security policies
+	benchmark_obstack_threads<boost::arena::obstack, timing_registry::BENCHMARK_OBSTACK>(
+		num_threads, alloc_orders, free_orders, per_thread_iterations, timings);
+	benchmark_obstack_threads<checksum_only_obstack, timing_registry::BENCHMARK_OBSTACK_CHECKSUM_ONLY>(
+		num_threads, alloc_orders, free_orders, per_thread_iterations, timings);
+	benchmark_obstack_threads<unchecked_obstack, timing_registry::BENCHMARK_OBSTACK_UNCHECKED>(
+		num_threads, alloc_orders, free_orders, per_thread_iterations, timings);
 	
 	
 	//print statistics
@@ -392,10 +472,708 @@ static void benchmark_threaded(
 		timings.get(timing_registry::BENCHMARK_NEW_DELETE).total_milliseconds() << "ms" << std::endl;
 	std::cout << "                 obstack arena: " <<
 		timings.get(timing_registry::BENCHMARK_OBSTACK).total_milliseconds() << "ms" << std::endl;
+	std::cout << "  obstack arena, checksum only: " <<
+		timings.get(timing_registry::BENCHMARK_OBSTACK_CHECKSUM_ONLY).total_milliseconds() << "ms" << std::endl;
+	std::cout << "      obstack arena, unchecked: " <<
+		timings.get(timing_registry::BENCHMARK_OBSTACK_UNCHECKED).total_milliseconds() << "ms" << std::endl;
+	std::cout << std::endl;
+}
+
+//fills the arena with small fixed-size objects and resets it, the
+//time per object is the cost of the alloc<T>() fast path
+template<class Arena>
+static double benchmark_hot_path(const size_t num_objects, const size_t iterations) {
+	Arena arena(num_objects * (sizeof(int) + Arena::max_overhead(1)));
+
+	ptime start(microsec_clock::universal_time());
+	for(size_t i=0; i<iterations; i++) {
+		for(size_t k=0; k<num_objects; k++) {
+			int * const p = arena.template alloc<int>(static_cast<int>(k));
+			CHECK_ALLOC(reinterpret_cast<volatile char*>(p));
+		}
+		arena.dealloc_all();
+	}
+	ptime end(microsec_clock::universal_time());
+
+	return static_cast<double>((end-start).total_microseconds()) * 1000.0 / static_cast<double>(num_objects * iterations);
+}
+
+//bump_obstack has no per-object overhead
+template<class A>
+struct bump_hot_path_arena : public boost::arena::basic_bump_obstack<A> {
+	explicit bump_hot_path_arena(size_t capacity) : boost::arena::basic_bump_obstack<A>(capacity) {}
+	static size_t max_overhead(size_t) { return boost::alignment_of<boost::arena::max_align_t>::value; }
+};
+
+static void benchmark_hot_paths() {
+	const size_t num_objects = 1024*1024;
+	const size_t iterations = 100;
+
+	std::cout << "running alloc<int>() fast path benchmark" << std::endl;
+	std::cout << "  timings per object:" << std::endl;
+	std::cout << "                 obstack arena: " <<
+		benchmark_hot_path<boost::arena::obstack>(num_objects, iterations) << "ns" << std::endl;
+	std::cout << "  obstack arena, checksum only: " <<
+		benchmark_hot_path<checksum_only_obstack>(num_objects, iterations) << "ns" << std::endl;
+	std::cout << "      obstack arena, unchecked: " <<
+		benchmark_hot_path<unchecked_obstack>(num_objects, iterations) << "ns" << std::endl;
+	std::cout << "                  bump_obstack: " <<
+		benchmark_hot_path<bump_hot_path_arena<std::allocator<boost::arena::max_align_t> > >(num_objects, iterations) << "ns" << std::endl;
+	std::cout << std::endl;
+}
+
+#ifdef BOOST_ARENA_HAS_NUMA
+typedef boost::arena::numa_allocator<boost::arena::max_align_t> numa_allocator_type;
+typedef boost::arena::basic_obstack<numa_allocator_type> numa_obstack;
+
+//runs pinned to cpu_node on an obstack placed on memory_node and writes every allocated byte
+static void benchmark_numa_obstack(
+	const int cpu_node,
+	const int memory_node,
+	const alloc_order_vec &alloc_seq,
+	const size_t iterations,
+	time_duration &result
+) {
+	numa_run_on_node(cpu_node);
+
+	std::vector<char*> chunks;
+	chunks.resize(alloc_seq.size());
+
+	const size_t required_size = sum_vec(alloc_seq) + numa_obstack::max_overhead(alloc_seq.size());
+	numa_obstack obs(required_size, numa_allocator_type(memory_node, boost::arena::mmap_options::populate));
+
+	ptime start(microsec_clock::universal_time());
+
+	for(size_t i=0; i<iterations; i++) {
+		for(size_t i=0; i<alloc_seq.size(); i++) {
+			const size_t s = alloc_seq[i];
+			chunks[i] = obs.alloc_array<char>(s);
+			CHECK_ALLOC(chunks[i]);
+			std::memset(chunks[i], static_cast<int>(i), s);
+		}
+		for(size_t i=0; i<chunks.size(); i++) {
+			char* const p = chunks[chunks.size()-1-i];
+			obs.dealloc(p);
+		}
+	}
+
+	ptime end(microsec_clock::universal_time());
+	result = end-start;
+}
+
+static void benchmark_numa(
+	const size_t total_memory,
+	const size_t min_alloc_size,
+	const size_t max_alloc_size,
+	const size_t iterations
+) {
+	std::cout << "running NUMA placement benchmark" << std::endl;
+	if(numa_allocator_type::max_node() < 1) {
+		std::cout << "  skipped: needs at least 2 NUMA nodes" << std::endl;
+		return;
+	}
+
+	const alloc_order_vec alloc_seq = make_alloc_sequence(total_memory, min_alloc_size, max_alloc_size);
+	const int remote_node = numa_allocator_type::max_node();
+	time_duration local;
+	time_duration remote;
+	{
+		boost::thread t(boost::bind(benchmark_numa_obstack, 0, 0, boost::cref(alloc_seq), iterations, boost::ref(local)));
+		t.join();
+	}
+	{
+		boost::thread t(boost::bind(benchmark_numa_obstack, 0, remote_node, boost::cref(alloc_seq), iterations, boost::ref(remote)));
+		t.join();
+	}
+
+	std::cout << "           memory: " << total_memory / 1024 << "kB" << std::endl;
+	std::cout << "     min/max size: " << min_alloc_size << "B/" << max_alloc_size << "B" << std::endl;
+	std::cout << "  timings:" << std::endl;
+	std::cout << "     node 0 on node 0 memory: " << local.total_milliseconds() << "ms" << std::endl;
+	std::cout << "     node 0 on node " << remote_node << " memory: " << remote.total_milliseconds() << "ms" << std::endl;
+	std::cout << std::endl;
+}
+#endif //BOOST_ARENA_HAS_NUMA
+
+//mostly 16-256 byte nodes, every 64th allocation is a 4kB-64kB buffer
+struct small_object_sizes {
+	small_object_sizes() :
+		pick(0, 63),
+		small(16, 256),
+		large(4*1024, 64*1024)
+	{}
+	size_t operator()(boost::mt19937 &gen) { return pick(gen) ? small(gen) : large(gen); }
+	boost::uniform_int<size_t> pick;
+	boost::uniform_int<size_t> small;
+	boost::uniform_int<size_t> large;
+};
+
+//log-normal sizes with a long tail and the given mean and standard deviation, clamped to [1B, 1MB]
+struct lognormal_sizes {
+	lognormal_sizes(const double mean, const double sd) : dist(log_mean(mean, sd), std::sqrt(log_variance(mean, sd))) {}
+	size_t operator()(boost::mt19937 &gen) {
+		const double s = dist(gen);
+		return s < 1.0 ? 1 : (s > 1024.0*1024.0 ? 1024*1024 : static_cast<size_t>(s));
+	}
+	//boost::random::lognormal_distribution takes the parameters of the underlying normal distribution
+	static double log_variance(const double mean, const double sd) { return std::log(1.0 + (sd*sd)/(mean*mean)); }
+	static double log_mean(const double mean, const double sd) { return std::log(mean) - log_variance(mean, sd)/2.0; }
+	boost::random::lognormal_distribution<double> dist;
+};
+
+//replays recorded sizes, one decimal size per line, and starts over at the end
+struct recorded_sizes {
+	explicit recorded_sizes(const alloc_order_vec &sizes) : sizes(&sizes), next(0) {}
+	size_t operator()(boost::mt19937 &) {
+		const size_t s = (*sizes)[next];
+		next = (next+1) % sizes->size();
+		return s;
+	}
+	const alloc_order_vec *sizes;
+	size_t next;
+};
+
+static alloc_order_vec load_size_trace(const char * const path) {
+	alloc_order_vec sizes;
+	std::ifstream in(path);
+	size_t s = 0;
+	while(in >> s) {
+		if(s) {
+			sizes.push_back(s);
+		}
+	}
+	return sizes;
+}
+
+static inline boost::uint64_t now_ns() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<boost::uint64_t>(ts.tv_sec)*1000000000u + static_cast<boost::uint64_t>(ts.tv_nsec);
+}
+
+//the smallest time between two calls of now_ns, subtracted from every sample
+static boost::uint64_t clock_overhead_ns() {
+	boost::uint64_t overhead = static_cast<boost::uint64_t>(-1);
+	for(size_t i=0; i<1000; i++) {
+		const boost::uint64_t t0 = now_ns();
+		const boost::uint64_t t1 = now_ns();
+		overhead = std::min(overhead, t1-t0);
+	}
+	return overhead;
+}
+
+//per-operation latencies in ns, percentiles are exact
+class latency_samples {
+public:
+	void reserve(const size_t n) { samples.reserve(n); }
+	void add(const boost::uint64_t ns) { samples.push_back(ns); }
+
+	boost::uint64_t percentile(const double p) {
+		if(samples.empty()) {
+			return 0;
+		}
+		const size_t k = std::min(samples.size()-1, static_cast<size_t>(p * static_cast<double>(samples.size())));
+		std::nth_element(samples.begin(), samples.begin()+k, samples.end());
+		return samples[k];
+	}
+
+private:
+	std::vector<boost::uint64_t> samples;
+};
+
+//counts hardware cache misses of the calling thread, if the kernel lets us
+class cache_miss_counter
+	: private boost::noncopyable
+{
+public:
+	cache_miss_counter() : fd(-1) {
+#ifdef __linux__
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+	~cache_miss_counter() {
+		if(fd >= 0) {
+			close(fd);
+		}
+	}
+
+	bool is_available() const { return fd >= 0; }
+
+	void start() {
+#ifdef __linux__
+		if(fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	long long stop() {
+		long long count = -1;
+#ifdef __linux__
+		if(fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if(read(fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) {
+				count = -1;
+			}
+		}
+#endif
+		return count;
+	}
+
+private:
+	int fd;
+};
+
+//the allocators under test, all with the same interface
+struct malloc_workload_arena {
+	explicit malloc_workload_arena(size_t) {}
+	char* alloc(const size_t s) { return static_cast<char*>(malloc(s)); }
+	void dealloc(char * const p, size_t) { free(p); }
+	void reset() {}
+	static const char* name() { return BOOST_ARENA_BENCHMARK_MALLOC; }
+};
+
+template<class Obstack>
+struct obstack_workload_arena {
+	explicit obstack_workload_arena(const size_t capacity) : obs(capacity, boost::arena::block_growth()) {}
+	char* alloc(const size_t s) { return obs.template alloc_array<char>(s); }
+	void dealloc(char * const p, const size_t s) { obs.dealloc(p, s); }
+	void reset() { obs.dealloc_all(); }
+	Obstack obs;
+};
+
+//bump_obstack frees nothing until the arena is reset after each round
+struct bump_workload_arena {
+	explicit bump_workload_arena(const size_t capacity) : obs(capacity) {}
+	char* alloc(const size_t s) { return obs.alloc_array<char>(s); }
+	void dealloc(char *, size_t) {}
+	void reset() { obs.dealloc_all(); }
+	boost::arena::bump_obstack obs;
+};
+
+//one boost::pool per 16 byte size class up to 256 bytes, larger sizes go to malloc
+class pool_workload_arena
+	: private boost::noncopyable
+{
+public:
+	enum {
+		granularity = 16,
+		max_pooled = 256,
+		num_pools = max_pooled / granularity
+	};
+
+	explicit pool_workload_arena(size_t) {
+		for(size_t i=0; i<num_pools; i++) {
+			pools[i] = new boost::pool<>((i+1)*granularity);
+		}
+	}
+	~pool_workload_arena() {
+		for(size_t i=0; i<num_pools; i++) {
+			delete pools[i];
+		}
+	}
+
+	char* alloc(const size_t s) {
+		return s <= max_pooled ? static_cast<char*>(pools[(s-1)/granularity]->malloc()) : static_cast<char*>(malloc(s));
+	}
+	void dealloc(char * const p, const size_t s) {
+		if(s <= max_pooled) {
+			pools[(s-1)/granularity]->free(p);
+		} else {
+			free(p);
+		}
+	}
+	void reset() {}
+
+private:
+	boost::pool<> *pools[num_pools];
+};
+
+struct workload_result {
+	double ops_per_sec;
+	long long cache_misses;
+	boost::uint64_t alloc_p50, alloc_p99, alloc_p999;
+	boost::uint64_t free_p50, free_p99, free_p999;
+};
+
+//an allocation or a deallocation of the chunk with the given index
+struct workload_op {
+	size_t chunk;
+	bool is_alloc;
+};
+typedef std::vector<workload_op> workload_op_vec;
+
+//allocate all chunks in order, then free them in free_seq order
+static workload_op_vec make_workload_ops(const alloc_order_vec &free_seq) {
+	workload_op_vec ops;
+	ops.reserve(2*free_seq.size());
+	for(size_t i=0; i<free_seq.size(); i++) {
+		const workload_op op = { i, true };
+		ops.push_back(op);
+	}
+	for(size_t i=0; i<free_seq.size(); i++) {
+		const workload_op op = { free_seq[i], false };
+		ops.push_back(op);
+	}
+	return ops;
+}
+
+/**
+ * runs the ops on chunks of the given sizes, iterations times.
+ * Every chunk must be freed by the ops, the arena is reset after each round.
+ * The throughput and cache misses come from rounds without per-operation timing,
+ * the latencies from one extra round that reads the clock around every call.
+ */
+template<class Arena>
+static workload_result run_workload(
+	const alloc_order_vec &sizes,
+	const workload_op_vec &ops,
+	const size_t capacity,
+	const size_t iterations
+) {
+	std::vector<char*> chunks;
+	chunks.resize(sizes.size());
+	Arena arena(capacity);
+
+	workload_result r;
+	cache_miss_counter misses;
+	const boost::uint64_t start = now_ns();
+	misses.start();
+	for(size_t i=0; i<iterations; i++) {
+		for(size_t k=0; k<ops.size(); k++) {
+			const size_t c = ops[k].chunk;
+			if(ops[k].is_alloc) {
+				chunks[c] = arena.alloc(sizes[c]);
+				CHECK_ALLOC(chunks[c]);
+			} else {
+				arena.dealloc(chunks[c], sizes[c]);
+			}
+		}
+		arena.reset();
+	}
+	r.cache_misses = misses.stop();
+	const boost::uint64_t elapsed = now_ns() - start;
+	r.ops_per_sec = static_cast<double>(ops.size() * iterations) * 1e9 / static_cast<double>(elapsed ? elapsed : 1);
+
+	const boost::uint64_t overhead = clock_overhead_ns();
+	latency_samples allocs;
+	latency_samples frees;
+	allocs.reserve(ops.size());
+	frees.reserve(ops.size());
+	for(size_t k=0; k<ops.size(); k++) {
+		const size_t c = ops[k].chunk;
+		if(ops[k].is_alloc) {
+			const boost::uint64_t t0 = now_ns();
+			chunks[c] = arena.alloc(sizes[c]);
+			const boost::uint64_t t1 = now_ns();
+			CHECK_ALLOC(chunks[c]);
+			allocs.add(t1-t0 > overhead ? t1-t0-overhead : 0);
+		} else {
+			const boost::uint64_t t0 = now_ns();
+			arena.dealloc(chunks[c], sizes[c]);
+			const boost::uint64_t t1 = now_ns();
+			frees.add(t1-t0 > overhead ? t1-t0-overhead : 0);
+		}
+	}
+	arena.reset();
+
+	r.alloc_p50 = allocs.percentile(0.5);
+	r.alloc_p99 = allocs.percentile(0.99);
+	r.alloc_p999 = allocs.percentile(0.999);
+	r.free_p50 = frees.percentile(0.5);
+	r.free_p99 = frees.percentile(0.99);
+	r.free_p999 = frees.percentile(0.999);
+	return r;
+}
+
+static void print_workload_header() {
+	std::cout <<
+		std::setw(32) << "" <<
+		std::setw(12) << "ops/s" <<
+		std::setw(20) << "alloc p50/99/999" <<
+		std::setw(20) << "free p50/99/999" <<
+		std::setw(14) << "cache misses" << std::endl;
+}
+
+template<class Arena>
+static void print_workload(
+	const char * const label,
+	const alloc_order_vec &sizes,
+	const workload_op_vec &ops,
+	const size_t capacity,
+	const size_t iterations
+) {
+	const workload_result r = run_workload<Arena>(sizes, ops, capacity, iterations);
+	std::ostringstream alloc_lat;
+	alloc_lat << r.alloc_p50 << "/" << r.alloc_p99 << "/" << r.alloc_p999;
+	std::ostringstream free_lat;
+	free_lat << r.free_p50 << "/" << r.free_p99 << "/" << r.free_p999;
+	std::ostringstream cache;
+	if(r.cache_misses >= 0) {
+		cache << r.cache_misses;
+	} else {
+		cache << "n/a";
+	}
+	std::cout <<
+		std::setw(30) << label << ": " <<
+		std::setw(12) << static_cast<long long>(r.ops_per_sec) <<
+		std::setw(20) << alloc_lat.str() <<
+		std::setw(20) << free_lat.str() <<
+		std::setw(14) << cache.str() << std::endl;
+}
+
+static void benchmark_workload(
+	const char * const distribution,
+	const alloc_order_vec &alloc_seq,
+	const size_t iterations
+) {
+	alloc_order_vec reverse_seq;
+	reverse_seq.resize(alloc_seq.size());
+	for(size_t i=0; i<reverse_seq.size(); i++) {
+		reverse_seq[i] = reverse_seq.size()-1-i;
+	}
+	const alloc_order_vec random_seq = make_free_sequence(alloc_seq);
+
+	const alloc_order_vec * const free_seqs[] = { &reverse_seq, &random_seq };
+	const char * const free_names[] = { "reverse", "random" };
+	const size_t capacity = sum_vec(alloc_seq) + boost::arena::obstack::max_overhead(alloc_seq.size());
+
+	for(size_t i=0; i<2; i++) {
+		const workload_op_vec ops = make_workload_ops(*free_seqs[i]);
+		std::cout << "running workload benchmark: " << distribution << " sizes, " << free_names[i] << " free order" << std::endl;
+		std::cout << "                   allocations: " << alloc_seq.size() << std::endl;
+		std::cout << "                        memory: " << sum_vec(alloc_seq) / 1024 << "kB" << std::endl;
+		print_workload_header();
+		print_workload<obstack_workload_arena<boost::arena::obstack> >("obstack arena", alloc_seq, ops, capacity, iterations);
+		print_workload<obstack_workload_arena<unchecked_obstack> >("obstack arena, unchecked", alloc_seq, ops, capacity, iterations);
+		print_workload<obstack_workload_arena<hole_reuse_obstack> >("obstack arena, hole reuse", alloc_seq, ops, capacity, iterations);
+		print_workload<bump_workload_arena>("bump_obstack, reset only", alloc_seq, ops, capacity, iterations);
+		print_workload<malloc_workload_arena>(malloc_workload_arena::name(), alloc_seq, ops, capacity, iterations);
+		print_workload<pool_workload_arena>("boost::pool size classes", alloc_seq, ops, capacity, iterations);
+		std::cout << "  latencies in ns" << std::endl;
+		std::cout << std::endl;
+	}
+}
+
+static void benchmark_workloads(const char * const trace_path) {
+	const size_t total_memory = 1024*1024* 64;
+	const size_t iterations = 5;
+
+	if(trace_path) {
+		const alloc_order_vec trace = load_size_trace(trace_path);
+		if(trace.empty()) {
+			std::cerr << "no sizes in " << trace_path << std::endl;
+			exit(1);
+		}
+		benchmark_workload("recorded", make_alloc_sequence(total_memory, recorded_sizes(trace)), iterations);
+		return;
+	}
+	benchmark_workload("small object", make_alloc_sequence(total_memory, small_object_sizes()), iterations);
+	benchmark_workload("log-normal", make_alloc_sequence(total_memory, lognormal_sizes(128.0, 512.0)), iterations);
+}
+
+typedef boost::arena::basic_obstack<
+	std::allocator<boost::arena::max_align_t>,
+	boost::arena::trace_stats<1024*1024>
+> tracing_obstack;
+
+/**
+ * turns a recorded trace into workload ops, every traced allocation becomes a chunk.
+ * Rewinds and resets become deallocations of the chunks they reclaim,
+ * chunks still live at the end of the trace are freed in reverse order.
+ * capacity is set to the peak of live bytes plus the obstack overhead.
+ */
+static workload_op_vec translate_trace(
+	const std::vector<boost::arena::trace_event> &events,
+	alloc_order_vec &sizes,
+	size_t &capacity
+) {
+	typedef boost::arena::trace_event event;
+	typedef std::map<boost::uint64_t, size_t> live_map;
+	//chunks allocated on the top of stack with their position, in allocation order
+	typedef std::vector<std::pair<boost::uint64_t, size_t> > position_stack;
+
+	workload_op_vec ops;
+	live_map live;
+	position_stack stack;
+	std::vector<boost::uint64_t> addresses;
+	size_t live_bytes = 0;
+	capacity = 0;
+
+	sizes.clear();
+	for(size_t i=0; i<events.size(); i++) {
+		const event &e = events[i];
+		std::vector<size_t> freed;
+		switch(e.kind) {
+		case event::allocate:
+		case event::reuse: {
+			const size_t c = sizes.size();
+			sizes.push_back(e.size ? e.size : 1);
+			addresses.push_back(e.object);
+			live[e.object] = c;
+			if(e.kind == event::allocate) {
+				stack.push_back(std::make_pair(e.position, c));
+			}
+			const workload_op op = { c, true };
+			ops.push_back(op);
+			live_bytes += sizes[c];
+			capacity = std::max(capacity, live_bytes + boost::arena::obstack::max_overhead(live.size()));
+			break;
+		}
+		case event::dealloc_top:
+		case event::dealloc:
+		case event::unallocate: {
+			const live_map::iterator it = live.find(e.object);
+			//objects allocated before the ring buffer wrapped around are unknown
+			if(it != live.end()) {
+				freed.push_back(it->second);
+			}
+			break;
+		}
+		case event::rewind:
+			while(!stack.empty() && stack.back().first >= e.position) {
+				const size_t c = stack.back().second;
+				const live_map::iterator it = live.find(addresses[c]);
+				if(it != live.end() && it->second == c) {
+					freed.push_back(c);
+				}
+				stack.pop_back();
+			}
+			break;
+		case event::reset:
+			for(live_map::const_iterator it = live.begin(); it != live.end(); ++it) {
+				freed.push_back(it->second);
+			}
+			std::sort(freed.begin(), freed.end(), std::greater<size_t>());
+			stack.clear();
+			break;
+		}
+		for(size_t k=0; k<freed.size(); k++) {
+			const workload_op op = { freed[k], false };
+			ops.push_back(op);
+			live.erase(addresses[freed[k]]);
+			live_bytes -= sizes[freed[k]];
+		}
+	}
+
+	std::vector<size_t> rest;
+	for(live_map::const_iterator it = live.begin(); it != live.end(); ++it) {
+		rest.push_back(it->second);
+	}
+	std::sort(rest.begin(), rest.end(), std::greater<size_t>());
+	for(size_t k=0; k<rest.size(); k++) {
+		const workload_op op = { rest[k], false };
+		ops.push_back(op);
+	}
+	return ops;
+}
+
+//records request-scoped traffic: each request allocates small objects
+//after a marker, frees some of them early and is rewound at the end
+static void record_trace(const char * const path) {
+	boost::scoped_ptr<tracing_obstack> obs(new tracing_obstack(1024*1024* 16, boost::arena::block_growth()));
+	boost::mt19937 gen;
+	gen.seed(42);
+	small_object_sizes sizes;
+	boost::uniform_int<size_t> objects_per_request(8, 64);
+	boost::uniform_int<size_t> coin(0, 3);
+
+	std::vector<char*> chunks;
+	std::vector<size_t> chunk_sizes;
+	while(obs->get_stats_policy().recorded() + 2*64 < tracing_obstack::stats_policy::capacity) {
+		const tracing_obstack::marker m = obs->mark();
+		const size_t n = objects_per_request(gen);
+		chunks.clear();
+		chunk_sizes.clear();
+		for(size_t i=0; i<n; i++) {
+			chunk_sizes.push_back(sizes(gen));
+			chunks.push_back(obs->alloc_array<char>(chunk_sizes.back()));
+			CHECK_ALLOC(chunks.back());
+		}
+		for(size_t i=0; i<n; i++) {
+			if(coin(gen) == 0) {
+				obs->dealloc(chunks[i], chunk_sizes[i]);
+			}
+		}
+		obs->rewind_to(m);
+	}
+
+	std::ofstream out(path, std::ios::binary);
+	if(!boost::arena::write_trace(out, obs->get_stats_policy())) {
+		std::cerr << "writing " << path << " failed" << std::endl;
+		exit(1);
+	}
+	std::cout << "recorded " << obs->get_stats_policy().size() << " events to " << path << std::endl;
+}
+
+static void benchmark_replay(const char * const path) {
+	std::vector<boost::arena::trace_event> events;
+	std::ifstream in(path, std::ios::binary);
+	if(!boost::arena::read_trace(in, events)) {
+		std::cerr << path << " is not an obstack trace" << std::endl;
+		exit(1);
+	}
+
+	alloc_order_vec sizes;
+	size_t capacity = 0;
+	const workload_op_vec ops = translate_trace(events, sizes, capacity);
+	const size_t iterations = 20;
+
+	std::cout << "replaying trace " << path << std::endl;
+	std::cout << "                        events: " << events.size() << std::endl;
+	std::cout << "                   allocations: " << sizes.size() << std::endl;
+	std::cout << "                 peak capacity: " << capacity / 1024 << "kB" << std::endl;
+	print_workload_header();
+	print_workload<obstack_workload_arena<boost::arena::obstack> >("obstack arena", sizes, ops, capacity, iterations);
+	print_workload<obstack_workload_arena<unchecked_obstack> >("obstack arena, unchecked", sizes, ops, capacity, iterations);
+	print_workload<obstack_workload_arena<hole_reuse_obstack> >("obstack arena, hole reuse", sizes, ops, capacity, iterations);
+	print_workload<malloc_workload_arena>(malloc_workload_arena::name(), sizes, ops, capacity, iterations);
+	print_workload<pool_workload_arena>("boost::pool size classes", sizes, ops, capacity, iterations);
+	std::cout << "  latencies in ns" << std::endl;
 	std::cout << std::endl;
 }
 
 int main(int argc, char **argv) {
+	//"arena_benchmark hotpath" only measures the alloc<T>() fast path
+	if(argc > 1 && std::string(argv[1]) == "hotpath") {
+		benchmark_hot_paths();
+		return 0;
+	}
+	//"arena_benchmark workload [size trace]" runs realistic size distributions against other allocators
+	if(argc > 1 && std::string(argv[1]) == "workload") {
+		benchmark_workloads(argc > 2 ? argv[2] : NULL);
+		return 0;
+	}
+	//"arena_benchmark record trace.bin" writes a trace of a request-scoped workload
+	if(argc > 2 && std::string(argv[1]) == "record") {
+		record_trace(argv[2]);
+		return 0;
+	}
+	//"arena_benchmark replay trace.bin" replays a recorded trace against obstack and other allocators
+	if(argc > 2 && std::string(argv[1]) == "replay") {
+		benchmark_replay(argv[2]);
+		return 0;
+	}
+	//"arena_benchmark numa" only compares local and remote memory placement
+	if(argc > 1 && std::string(argv[1]) == "numa") {
+#ifdef BOOST_ARENA_HAS_NUMA
+		benchmark_numa(1024*1024* 64, 16, 256, 20);
+		return 0;
+#else
+		std::cerr << "built without NUMA support" << std::endl;
+		return 1;
+#endif
+	}
+
 	const size_t total_memory = 1024*1024* 512;
 	const size_t min_alloc_size = 1;
 	const size_t max_alloc_size = 1024*1024* 4;
@@ -1,7 +1,14 @@
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include <sys/mman.h>
+#include <sys/wait.h>
+
 #define BOOST_TEST_MAIN
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE obstack_test
@@ -9,11 +16,39 @@
 #include <boost/function.hpp>
 #include <boost/type_traits/alignment_of.hpp>
 #include <boost/cstdint.hpp>
+#include <boost/config.hpp>
+#include <boost/container/vector.hpp>
+
+#ifndef BOOST_NO_CXX11_HDR_SCOPED_ALLOCATOR
+#include <scoped_allocator>
+#endif
+#ifndef BOOST_NO_CXX11_THREAD_LOCAL
+#include <thread>
+#endif
 
 
 #include "obstack.hpp"
+#include "bump_obstack.hpp"
+#include "concurrent_obstack.hpp"
+#include "obstack_allocator.hpp"
+#include "obstack_hash_map.hpp"
+#include "obstack_list.hpp"
+#include "obstack_ptr.hpp"
+#include "obstack_trace.hpp"
+#include "obstack_vector.hpp"
+#include "persistent_obstack.hpp"
+#include "ring_obstack.hpp"
+#include "shm_obstack.hpp"
+#include "typed_obstack.hpp"
+#ifndef BOOST_NO_CXX11_THREAD_LOCAL
+#include "thread_local_obstack.hpp"
+#endif
 #include "max_alignment_type.hpp"
 #include "null_allocator.hpp"
+#include "mmap_allocator.hpp"
+#ifdef BOOST_ARENA_HAS_NUMA
+#include "numa_allocator.hpp"
+#endif
 
 using boost::arena::obstack;
 
@@ -616,33 +651,2172 @@ BOOST_AUTO_TEST_CASE( obstack_on_stack_space ) {
 	BOOST_CHECK( is_aligned(s2) );
 }
 
+BOOST_AUTO_TEST_CASE( obstack_full_returns_null ) {
+	obstack vs(1024);
 
-/*
-BOOST_AUTO_TEST_CASE( obstack_nesting ) {
+	char *a = vs.alloc_array<char>(4096);
+	BOOST_CHECK( a == NULL );
+	BOOST_CHECK_EQUAL( vs.capacity(), 1024 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_growable_chains_blocks ) {
+	obstack vs(1024, boost::arena::block_growth());
+
+	char *a = vs.alloc_array<char>(512);
+	BOOST_REQUIRE( a != NULL );
+	char *b = vs.alloc_array<char>(4096);
+	BOOST_REQUIRE( b != NULL );
+	BOOST_CHECK( vs.capacity() > 1024 );
+	BOOST_CHECK( vs.size() >= 512+4096 );
+
+	for(int i=0; i<4096; i++) {
+		b[i] = 42;
+	}
+	BOOST_CHECK( vs.is_top(b) );
+	BOOST_CHECK( vs.is_valid(b) );
+	BOOST_CHECK( vs.is_valid(a) );
+
+	vs.dealloc(b);
+	BOOST_CHECK_EQUAL( vs.capacity(), 1024 );
+	BOOST_CHECK( vs.is_top(a) );
+	BOOST_CHECK( vs.size() >= 512 );
+	BOOST_CHECK( vs.size() < 1024 );
+}
 
+BOOST_AUTO_TEST_CASE( obstack_growable_dtor_chain ) {
 	_num_dtor_calls = 0;
+	{
+		obstack vs(256, boost::arena::block_growth());
+		for(int i=0; i<100; i++) {
+			Sensor *s = vs.alloc<Sensor>();
+			BOOST_REQUIRE( s != NULL );
+			s->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+		}
+		BOOST_CHECK( vs.capacity() > 256 );
+	}
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 100 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_growable_out_of_order_release ) {
+	obstack vs(256, boost::arena::block_growth());
+
+	std::vector<char*> chunks;
+	for(int i=0; i<64; i++) {
+		char *c = vs.alloc_array<char>(100);
+		BOOST_REQUIRE( c != NULL );
+		chunks.push_back(c);
+	}
+	for(size_t i=0; i<chunks.size(); i++) {
+		vs.dealloc(chunks[i]);
+	}
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+	BOOST_CHECK_EQUAL( vs.capacity(), 256 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_growable_max_capacity ) {
+	obstack vs(1024, boost::arena::block_growth(2, 0, 4096));
+
+	char *a = vs.alloc_array<char>(2048);
+	BOOST_CHECK( a != NULL );
+	char *b = vs.alloc_array<char>(2048);
+	BOOST_CHECK( b == NULL );
+	BOOST_CHECK( vs.capacity() <= 4096 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_growable_max_capacity_counts_block_headers ) {
+	const std::size_t overhead =
+		boost::arena::arena_detail::block_chain<boost::arena::obstack::allocator_type>::block_overhead();
+	obstack vs(1024, boost::arena::block_growth(2, 0, 1024 + 2048));
+
+	BOOST_REQUIRE( vs.alloc_array<char>(900) != NULL );
+	//needs a chained block, its header has to fit into the limit as well
+	BOOST_REQUIRE( vs.alloc_array<char>(900) != NULL );
+	BOOST_CHECK( vs.capacity() > 1024 );
+	BOOST_CHECK( vs.capacity() + overhead <= 1024 + 2048 );
+	BOOST_CHECK( vs.alloc_array<char>(2048) == NULL );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_growable_max_block_size ) {
+	obstack vs(1024, boost::arena::block_growth(4, 2048));
+
+	for(int i=0; i<16; i++) {
+		BOOST_REQUIRE( vs.alloc_array<char>(500) != NULL );
+	}
+	BOOST_CHECK( vs.capacity() <= 1024 + 8*2048 );
+}
+BOOST_AUTO_TEST_CASE( bump_obstack_packing ) {
+	boost::arena::bump_obstack bs(default_size);
+
+	char *c1 = bs.alloc<char>();
+	char *c2 = bs.alloc<char>();
+	BOOST_REQUIRE( c1 != NULL );
+	BOOST_REQUIRE( c2 != NULL );
+	BOOST_CHECK_EQUAL( c2 - c1, 1 );
+	BOOST_CHECK_EQUAL( *c1, 0 );
+	BOOST_CHECK_EQUAL( bs.size(), 2 );
+
+	double *d = bs.alloc<double>(4.2);
+	BOOST_REQUIRE( d != NULL );
+	BOOST_CHECK( is_aligned(d) );
+	BOOST_CHECK_EQUAL( *d, 4.2 );
+	BOOST_CHECK_EQUAL( bs.size(), sizeof(double)*2 );
+}
+
+BOOST_AUTO_TEST_CASE( bump_obstack_mark_rewind ) {
+	boost::arena::bump_obstack bs(default_size);
+
+	int *i = bs.alloc<int>(42);
+	BOOST_REQUIRE( i != NULL );
+	const size_t size_at_mark = bs.size();
+	boost::arena::bump_obstack::marker m = bs.mark();
 
+	for(int k=0; k<100; k++) {
+		BOOST_REQUIRE( bs.alloc_array<char>(13) != NULL );
+	}
+	BOOST_CHECK( bs.size() > size_at_mark );
+
+	bs.rewind_to(m);
+	BOOST_CHECK_EQUAL( bs.size(), size_at_mark );
+	BOOST_CHECK_EQUAL( *i, 42 );
+
+	bs.dealloc_all();
+	BOOST_CHECK_EQUAL( bs.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( bump_obstack_full_returns_null ) {
+	boost::arena::bump_obstack bs(64);
+
+	BOOST_CHECK( bs.alloc_array<char>(64) != NULL );
+	BOOST_CHECK( bs.alloc<char>() == NULL );
+}
+
+BOOST_AUTO_TEST_CASE( bump_obstack_growable_rewind ) {
+	boost::arena::bump_obstack bs(64, boost::arena::block_growth());
+
+	boost::arena::bump_obstack::marker m = bs.mark();
+	for(int k=0; k<100; k++) {
+		BOOST_REQUIRE( bs.alloc<double_fun>() != NULL );
+	}
+	BOOST_CHECK( bs.capacity() > 64 );
+	BOOST_CHECK_EQUAL( bs.size(), 100*sizeof(double_fun) );
+
+	bs.rewind_to(m);
+	BOOST_CHECK_EQUAL( bs.size(), 0 );
+	BOOST_CHECK_EQUAL( bs.capacity(), 64 );
+}
+BOOST_AUTO_TEST_CASE( bump_obstack_scoped_checkpoint ) {
+	boost::arena::bump_obstack bs(default_size);
+
+	BOOST_REQUIRE( bs.alloc<int>() != NULL );
+	const size_t size_before = bs.size();
 	{
-		obstack l1(default_size);
-		obstack *l2 = l1.alloc<obstack>(default_size);
-		BOOST_REQUIRE( l2 != NULL );
-		obstack *l3 = l2->alloc<obstack>(default_size);
-		BOOST_REQUIRE( l3 != NULL );
-		
-		
-		Sensor *s1 = l1.alloc<Sensor>();
-		BOOST_REQUIRE( s1 != NULL);
-		Sensor *s2 = l3->alloc<Sensor>();
-		BOOST_REQUIRE( s2 != NULL);
+		boost::arena::bump_obstack::scoped_checkpoint cp(bs);
+		BOOST_REQUIRE( bs.alloc_array<char>(100) != NULL );
+		BOOST_CHECK( bs.size() > size_before );
+	}
+	BOOST_CHECK_EQUAL( bs.size(), size_before );
+}
 
-		s1->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
-		s2->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+BOOST_AUTO_TEST_CASE( bump_obstack_growable_rewind_to_chained_marker ) {
+	boost::arena::bump_obstack bs(64, boost::arena::block_growth());
+
+	while(bs.capacity() == 64) {
+		BOOST_REQUIRE( bs.alloc<double_fun>() != NULL );
+	}
+	const size_t size_at_mark = bs.size();
+	const size_t capacity_at_mark = bs.capacity();
+	boost::arena::bump_obstack::marker m = bs.mark();
+	for(int k=0; k<100; k++) {
+		BOOST_REQUIRE( bs.alloc<double_fun>() != NULL );
+	}
+	BOOST_CHECK( bs.capacity() > capacity_at_mark );
+
+	bs.rewind_to(m);
+	BOOST_CHECK_EQUAL( bs.size(), size_at_mark );
+	BOOST_CHECK_EQUAL( bs.capacity(), capacity_at_mark );
+	BOOST_REQUIRE( bs.alloc<double_fun>() != NULL );
+	BOOST_CHECK_EQUAL( bs.size(), size_at_mark + sizeof(double_fun) );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_growable_rewind_to_chained_marker ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(256, boost::arena::block_growth());
+	while(vs.capacity() == 256) {
+		BOOST_REQUIRE( vs.alloc<Sensor>() != NULL );
+	}
+	const size_t size_at_mark = vs.size();
+	const size_t capacity_at_mark = vs.capacity();
+	boost::arena::obstack::marker m = vs.mark();
+	for(int i=0; i<100; i++) {
+		Sensor *s = vs.alloc<Sensor>();
+		BOOST_REQUIRE( s != NULL );
+		s->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+	}
+	BOOST_CHECK( vs.capacity() > capacity_at_mark );
+
+	vs.rewind_to(m);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 100 );
+	BOOST_CHECK_EQUAL( vs.size(), size_at_mark );
+	BOOST_CHECK_EQUAL( vs.capacity(), capacity_at_mark );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_rewind_to_marker ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	Sensor *keep = vs.alloc<Sensor>();
+	BOOST_REQUIRE( keep != NULL );
+	keep->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+
+	const size_t size_at_mark = vs.size();
+	boost::arena::obstack::marker m = vs.mark();
+	for(int i=0; i<10; i++) {
+		BOOST_REQUIRE( vs.alloc_array<char>(13) != NULL );
+		Sensor *s = vs.alloc<Sensor>();
+		BOOST_REQUIRE( s != NULL );
+		s->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+		BOOST_REQUIRE( vs.alloc<int>(42) != NULL );
 	}
 
+	vs.rewind_to(m);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 10 );
+	BOOST_CHECK_EQUAL( vs.size(), size_at_mark );
+	BOOST_CHECK( vs.is_top(keep) );
+
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 11 );
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_rewind_skips_destructed ) {
+	_num_dtor_calls = 0;
 
+	obstack vs(default_size);
+	boost::arena::obstack::marker m = vs.mark();
+	std::vector<Sensor*> sensors;
+	for(int i=0; i<10; i++) {
+		Sensor *s = vs.alloc<Sensor>();
+		BOOST_REQUIRE( s != NULL );
+		s->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+		sensors.push_back(s);
+	}
+	vs.dealloc(sensors[2]);
+	vs.dealloc(sensors[5]);
 	BOOST_CHECK_EQUAL( _num_dtor_calls, 2 );
+
+	vs.rewind_to(m);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 10 );
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_rewind_reclaims_below_marker ) {
+	obstack vs(default_size);
+
+	Sensor *s = vs.alloc<Sensor>();
+	BOOST_REQUIRE( s != NULL );
+	boost::arena::obstack::marker m = vs.mark();
+	BOOST_REQUIRE( vs.alloc<Sensor>() != NULL );
+	vs.dealloc(s);
+	BOOST_CHECK( vs.size() > 0 );
+
+	vs.rewind_to(m);
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_scoped_checkpoint ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(256, boost::arena::block_growth());
+	{
+		boost::arena::obstack::scoped_checkpoint cp(vs);
+		for(int i=0; i<100; i++) {
+			Sensor *s = vs.alloc<Sensor>();
+			BOOST_REQUIRE( s != NULL );
+			s->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+		}
+		BOOST_CHECK( vs.capacity() > 256 );
+	}
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 100 );
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+	BOOST_CHECK_EQUAL( vs.capacity(), 256 );
+}
+BOOST_AUTO_TEST_CASE( obstack_allocator_std_vector ) {
+	typedef boost::arena::obstack_allocator<int> allocator_type;
+	obstack vs(default_size);
+
+	{
+		std::vector<int, allocator_type> v((allocator_type(vs)));
+		for(int i=0; i<1000; i++) {
+			v.push_back(i);
+		}
+		BOOST_CHECK( vs.size() >= 1000*sizeof(int) );
+		BOOST_CHECK( vs.is_valid(&v[0]) );
+		BOOST_CHECK_EQUAL( v[999], 999 );
+	}
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_allocator_basic_string ) {
+	typedef boost::arena::obstack_allocator<char> allocator_type;
+	typedef std::basic_string<char, std::char_traits<char>, allocator_type> string_type;
+	obstack vs(default_size);
+
+	string_type str("a string that is too long for the small string optimization", allocator_type(vs));
+	str += str;
+	BOOST_CHECK( vs.size() > str.size() );
+	BOOST_CHECK( str.get_allocator() == allocator_type(vs) );
 }
-*/
+
+BOOST_AUTO_TEST_CASE( obstack_allocator_boost_container ) {
+	typedef boost::arena::obstack_allocator<double_fun> allocator_type;
+	obstack vs(default_size);
+
+	boost::container::vector<double_fun, allocator_type> v((allocator_type(vs)));
+	v.resize(100);
+	BOOST_CHECK( vs.size() >= 100*sizeof(double_fun) );
+	BOOST_CHECK( is_aligned(&v[0]) );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_allocator_bump_obstack ) {
+	typedef boost::arena::obstack_allocator<int, boost::arena::bump_obstack> allocator_type;
+	boost::arena::bump_obstack bs(default_size);
+
+	{
+		std::vector<int, allocator_type> v((allocator_type(bs)));
+		v.reserve(100);
+		BOOST_CHECK_EQUAL( bs.size(), 100*sizeof(int) );
+	}
+	BOOST_CHECK_EQUAL( bs.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_allocator_equality ) {
+	obstack vs1(default_size);
+	obstack vs2(default_size);
+
+	boost::arena::obstack_allocator<int> a1(vs1);
+	boost::arena::obstack_allocator<char> a1_char(a1);
+	boost::arena::obstack_allocator<int> a2(vs2);
+	BOOST_CHECK( a1 == a1_char );
+	BOOST_CHECK( a1 != a2 );
+}
+
+#ifndef BOOST_NO_CXX11_HDR_SCOPED_ALLOCATOR
+BOOST_AUTO_TEST_CASE( obstack_allocator_scoped_nested_strings ) {
+	typedef boost::arena::obstack_allocator<char> char_allocator;
+	typedef std::basic_string<char, std::char_traits<char>, char_allocator> string_type;
+	typedef std::scoped_allocator_adaptor<boost::arena::obstack_allocator<string_type> > allocator_type;
+	obstack vs(default_size);
+
+	std::vector<string_type, allocator_type> v((allocator_type(vs)));
+	v.emplace_back("a string that is too long for the small string optimization");
+	v.emplace_back("another string that is too long for the small string optimization");
+
+	BOOST_CHECK( v[0].get_allocator() == char_allocator(vs) );
+	BOOST_CHECK( v[1].get_allocator() == char_allocator(vs) );
+	BOOST_CHECK( vs.size() > v[0].size() + v[1].size() );
+}
+#endif
+BOOST_AUTO_TEST_CASE( obstack_grow_top_in_place ) {
+	obstack vs(default_size);
+
+	char *a = vs.alloc_array<char>(16);
+	BOOST_REQUIRE( a != NULL );
+	const size_t size_before = vs.size();
+	for(int i=0; i<16; i++) {
+		a[i] = 42;
+	}
+
+	char *b = vs.grow_top(a, 1024);
+	BOOST_CHECK( b == a );
+	BOOST_CHECK_EQUAL( vs.size(), size_before + 1024 - 16 );
+	BOOST_CHECK_EQUAL( b[15], 42 );
+	b[1023] = 42;
+
+	vs.shrink_top(b, 32);
+	BOOST_CHECK_EQUAL( vs.size(), size_before + 32 - 16 );
+
+	vs.dealloc(b);
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_grow_top_not_top ) {
+	obstack vs(default_size);
+
+	char *a = vs.alloc_array<char>(16);
+	BOOST_REQUIRE( a != NULL );
+	BOOST_REQUIRE( vs.alloc<Sensor>() != NULL );
+	const size_t size_before = vs.size();
+
+	BOOST_CHECK( !vs.try_extend(a, 32) );
+	BOOST_CHECK( vs.grow_top(a, 32) == NULL );
+	vs.shrink_top(a, 8);
+	BOOST_CHECK_EQUAL( vs.size(), size_before );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_try_extend_full ) {
+	obstack vs(1024);
+
+	char *a = vs.alloc_array<char>(16);
+	BOOST_REQUIRE( a != NULL );
+	BOOST_CHECK( vs.try_extend(a, 512) );
+	BOOST_CHECK( !vs.try_extend(a, 4096) );
+	BOOST_CHECK( vs.grow_top(a, 4096) == NULL );
+	BOOST_CHECK( vs.is_top(a) );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_grow_top_moves_to_new_block ) {
+	obstack vs(1024, boost::arena::block_growth());
+
+	int *a = vs.alloc_array<int>(16);
+	BOOST_REQUIRE( a != NULL );
+	for(int i=0; i<16; i++) {
+		a[i] = i;
+	}
+
+	int *b = vs.grow_top(a, 4096);
+	BOOST_REQUIRE( b != NULL );
+	BOOST_CHECK( b != a );
+	BOOST_CHECK( vs.is_top(b) );
+	for(int i=0; i<16; i++) {
+		BOOST_CHECK_EQUAL( b[i], i );
+	}
+
+	vs.dealloc(b);
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+	BOOST_CHECK_EQUAL( vs.capacity(), 1024 );
+}
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+struct MoveSink {
+	MoveSink(std::string &&a, std::vector<int> &&b, const std::string &c, std::string &d, int e)
+		: a(std::move(a)), b(std::move(b)), c(c), d(d), e(e)
+	{}
+	std::string a;
+	std::vector<int> b;
+	std::string c;
+	std::string d;
+	int e;
+};
+
+BOOST_AUTO_TEST_CASE( obstack_ctor_perfect_forwarding ) {
+	obstack vs(default_size);
+
+	std::string a(100, 'a');
+	std::vector<int> b(100, 42);
+	std::string d("d");
+	MoveSink *m = vs.alloc<MoveSink>(std::move(a), std::move(b), "c", d, 5);
+	BOOST_REQUIRE( m != NULL );
+
+	BOOST_CHECK( a.empty() );
+	BOOST_CHECK( b.empty() );
+	BOOST_CHECK_EQUAL( m->a.size(), 100 );
+	BOOST_CHECK_EQUAL( m->b.size(), 100 );
+	BOOST_CHECK_EQUAL( m->c, "c" );
+	BOOST_CHECK_EQUAL( m->d, "d" );
+	BOOST_CHECK_EQUAL( m->e, 5 );
+}
+
+struct ThrowingCtor {
+	explicit ThrowingCtor(bool do_throw) {
+		if(do_throw) {
+			throw std::runtime_error("ctor failed");
+		}
+	}
+	Sensor s;
+};
+
+BOOST_AUTO_TEST_CASE( obstack_ctor_throws_rollback ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	Sensor *s = vs.alloc<Sensor>();
+	BOOST_REQUIRE( s != NULL );
+	const size_t size_before = vs.size();
+
+	BOOST_CHECK_THROW( vs.alloc<ThrowingCtor>(true), std::runtime_error );
+	BOOST_CHECK_EQUAL( vs.size(), size_before );
+	BOOST_CHECK( vs.is_top(s) );
+
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 0 );
+}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+BOOST_AUTO_TEST_CASE( obstack_alloc_array_of_complex_type ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	Sensor *s = vs.alloc_array<Sensor>(10);
+	BOOST_REQUIRE( s != NULL );
+	BOOST_CHECK( is_aligned(s) );
+	for(int i=0; i<10; i++) {
+		BOOST_CHECK_EQUAL( s[i].get_this_ptr(), &s[i] );
+		s[i].set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+	}
+	BOOST_CHECK( vs.is_top(s) );
+
+	vs.dealloc(s);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 10 );
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_array_of_complex_type_dealloc_all ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	BOOST_REQUIRE( vs.alloc<char>() != NULL );
+	Sensor *s = vs.alloc_array<Sensor>(10);
+	BOOST_REQUIRE( s != NULL );
+	for(int i=0; i<10; i++) {
+		s[i].set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+	}
+	BOOST_REQUIRE( vs.alloc<Sensor>() != NULL );
+
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 10 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_array_with_args ) {
+	obstack vs(default_size);
+
+	std::string *s = vs.alloc_array<std::string>(3, "foo");
+	BOOST_REQUIRE( s != NULL );
+	BOOST_CHECK_EQUAL( s[0], "foo" );
+	BOOST_CHECK_EQUAL( s[2], "foo" );
+
+	int *i = vs.alloc_array<int>(5, 42);
+	BOOST_REQUIRE( i != NULL );
+	BOOST_CHECK_EQUAL( i[0], 42 );
+	BOOST_CHECK_EQUAL( i[4], 42 );
+}
+
+static int _num_ctor_calls;
+struct ThrowsOnFifth {
+	ThrowsOnFifth() {
+		if(++_num_ctor_calls == 5) {
+			throw std::runtime_error("fifth element");
+		}
+		s.set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+	}
+	Sensor s;
+};
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_array_ctor_throws_rollback ) {
+	_num_dtor_calls = 0;
+	_num_ctor_calls = 0;
+
+	obstack vs(default_size);
+	BOOST_CHECK_THROW( vs.alloc_array<ThrowsOnFifth>(10), std::runtime_error );
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 4 );
+	BOOST_CHECK_EQUAL( vs.size(), 0 );
+
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 4 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_array_of_complex_type_reclaims_prefix ) {
+	obstack vs(4096);
+	BOOST_REQUIRE( vs.alloc<int>(1) != NULL );
+	const size_t size_before = vs.size();
+
+	for(int k=0; k<1000; k++) {
+		std::string *a = vs.alloc_array<std::string>(2);
+		BOOST_REQUIRE( a != NULL );
+		vs.dealloc(a);
+		BOOST_REQUIRE_EQUAL( vs.size(), size_before );
+	}
+
+	_num_ctor_calls = 0;
+	BOOST_CHECK_THROW( vs.alloc_array<ThrowsOnFifth>(10), std::runtime_error );
+	BOOST_CHECK_EQUAL( vs.size(), size_before );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_array_of_complex_type_growable ) {
+	_num_dtor_calls = 0;
+	{
+		obstack vs(256, boost::arena::block_growth());
+		Sensor *s = vs.alloc_array<Sensor>(100);
+		BOOST_REQUIRE( s != NULL );
+		for(int i=0; i<100; i++) {
+			s[i].set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+		}
+	}
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 100 );
+}
+#ifndef BOOST_NO_CXX11_THREAD_LOCAL
+struct thread_local_test_tag {};
+typedef boost::arena::thread_local_obstack<default_size, thread_local_test_tag> test_thread_local_obstack;
+
+static void use_thread_local_obstack(const void **obs_address) {
+	test_thread_local_obstack::obstack_type &obs = test_thread_local_obstack::get();
+	*obs_address = &obs;
+	BOOST_CHECK( obs.alloc<Sensor>() != NULL );
+	BOOST_CHECK( obs.alloc_array<char>(3*default_size) != NULL );
+	BOOST_CHECK( &test_thread_local_obstack::get() == &obs );
+}
+
+BOOST_AUTO_TEST_CASE( thread_local_obstack_recycles_blocks ) {
+	test_thread_local_obstack::reserve(2);
+	BOOST_CHECK( test_thread_local_obstack::cached_blocks() >= 2 );
+
+	const void *obs1 = NULL;
+	std::thread t1(use_thread_local_obstack, &obs1);
+	t1.join();
+	const size_t cached_after_first = test_thread_local_obstack::cached_blocks();
+	BOOST_CHECK( cached_after_first >= 2 );
+
+	const void *obs2 = NULL;
+	std::thread t2(use_thread_local_obstack, &obs2);
+	t2.join();
+	BOOST_CHECK_EQUAL( test_thread_local_obstack::cached_blocks(), cached_after_first );
+
+	BOOST_CHECK( obs1 != NULL );
+	BOOST_CHECK( &test_thread_local_obstack::get() != obs1 );
+}
+
+BOOST_AUTO_TEST_CASE( thread_local_obstack_chains_pool_blocks ) {
+	typedef boost::arena::thread_local_obstack<4096, thread_local_test_tag> small_obstack;
+	small_obstack::obstack_type &obs = small_obstack::get();
+
+	for(int i=0; i<10; i++) {
+		BOOST_REQUIRE( obs.alloc_array<char>(2000) != NULL );
+	}
+	const size_t cached = small_obstack::cached_blocks();
+	obs.dealloc_all();
+	obs.trim();
+	BOOST_CHECK( small_obstack::cached_blocks() > cached );
+}
+#endif //BOOST_NO_CXX11_THREAD_LOCAL
+typedef boost::arena::mmap_allocator<boost::arena::max_align_t> test_mmap_allocator;
+typedef boost::arena::basic_obstack<test_mmap_allocator> mmap_obstack;
+
+BOOST_AUTO_TEST_CASE( obstack_mmap_allocator ) {
+	mmap_obstack vs(default_size, test_mmap_allocator(boost::arena::mmap_options::populate));
+
+	char *c = vs.alloc_array<char>(default_size/2);
+	BOOST_REQUIRE( c != NULL );
+	c[0] = 42;
+	c[default_size/2-1] = 42;
+
+	std::string *s = vs.alloc<std::string>("foo");
+	BOOST_REQUIRE( s != NULL );
+	BOOST_CHECK( is_aligned(s) );
+	BOOST_CHECK_EQUAL( *s, "foo" );
+}
+
+BOOST_AUTO_TEST_CASE( mmap_allocator_equality ) {
+	const test_mmap_allocator plain;
+	const test_mmap_allocator huge(boost::arena::mmap_options::huge_pages);
+	BOOST_CHECK( plain == test_mmap_allocator() );
+	BOOST_CHECK( huge == boost::arena::mmap_allocator<char>(huge) );
+	BOOST_CHECK( plain != huge );
+	BOOST_CHECK( !(plain == huge) );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_mmap_allocator_huge_pages ) {
+	const int options =
+		boost::arena::mmap_options::huge_pages |
+		boost::arena::mmap_options::transparent_huge_pages;
+	mmap_obstack vs(default_size, boost::arena::block_growth(), test_mmap_allocator(options));
+
+	for(int i=0; i<4; i++) {
+		char *c = vs.alloc_array<char>(default_size);
+		BOOST_REQUIRE( c != NULL );
+		c[default_size-1] = 42;
+	}
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( vs.capacity(), default_size );
+}
+
+static size_t resident_pages(const void * const p, size_t const bytes) {
+	const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	const size_t first = reinterpret_cast<size_t>(p) & ~(page - 1);
+	const size_t num_pages = (reinterpret_cast<size_t>(p) + bytes - first + page - 1) / page;
+	std::vector<unsigned char> residency(num_pages);
+	if(mincore(reinterpret_cast<void*>(first), num_pages * page, &residency[0]) != 0) {
+		return 0;
+	}
+	size_t resident = 0;
+	for(size_t i=0; i<num_pages; i++) {
+		resident += residency[i] & 1;
+	}
+	return resident;
+}
+
+BOOST_AUTO_TEST_CASE( obstack_mmap_allocator_lazy_commit ) {
+	const size_t reserved = 256*1024*1024;
+	const size_t used = 4*1024*1024;
+	const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	mmap_obstack vs(reserved, test_mmap_allocator(boost::arena::mmap_options::reserve));
+	vs.set_decommit_watermark(64*1024);
+
+	int * const keep = vs.alloc<int>(42);
+	const mmap_obstack::marker m = vs.mark();
+	char * const c = vs.alloc_array<char>(used);
+	BOOST_REQUIRE( c != NULL );
+	BOOST_CHECK( resident_pages(c, used) < 2 );
+	std::memset(c, 1, used);
+	BOOST_CHECK( resident_pages(c, used) >= used / page );
+
+	vs.rewind_to(m);
+	BOOST_CHECK_LE( resident_pages(c, used), 64*1024 / page + 2 );
+	BOOST_CHECK_EQUAL( *keep, 42 );
+
+	//rewinding less than the watermark keeps the pages
+	char * const d = vs.alloc_array<char>(32*1024);
+	std::memset(d, 1, 32*1024);
+	vs.rewind_to(m);
+	BOOST_CHECK( resident_pages(d, 32*1024) >= 32*1024 / page - 1 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_decommit ) {
+	const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	mmap_obstack vs(1024*1024, test_mmap_allocator(boost::arena::mmap_options::populate));
+	std::string * const s = vs.alloc<std::string>("foo");
+	BOOST_REQUIRE( s != NULL );
+	BOOST_CHECK_EQUAL( vs.get_decommit_watermark(), mmap_obstack::no_decommit() );
+
+	const size_t released = vs.decommit(page);
+	BOOST_CHECK( released >= 1024*1024 - 3*page );
+	BOOST_CHECK( released % page == 0 );
+	BOOST_CHECK_EQUAL( *s, "foo" );
+
+	char * const c = vs.alloc_array<char>(2*page);
+	BOOST_REQUIRE( c != NULL );
+	std::memset(c, 1, 2*page);
+	BOOST_CHECK_EQUAL( vs.decommit(1024*1024), 0u );
+
+	vs.dealloc_all();
+	BOOST_CHECK( vs.decommit() > 0 );
+}
+
+typedef boost::arena::basic_obstack<std::allocator<boost::arena::max_align_t>, boost::arena::counting_stats> counting_obstack;
+
+BOOST_AUTO_TEST_CASE( obstack_stats_counts_allocations ) {
+	counting_obstack vs(default_size);
+
+	int *i1 = vs.alloc<int>(1);
+	char *c = vs.alloc<char>('c');
+	std::string *s = vs.alloc<std::string>("foo");
+	BOOST_REQUIRE( i1 != NULL && c != NULL && s != NULL );
+
+	boost::arena::obstack_stats st = vs.stats();
+	BOOST_CHECK_EQUAL( st.allocations, 3u );
+	BOOST_CHECK_EQUAL( st.chunks, 3u );
+	BOOST_CHECK_EQUAL( st.blocked_chunks, 0u );
+	BOOST_CHECK_EQUAL( st.payload_bytes, sizeof(int) + sizeof(char) + sizeof(std::string) );
+	BOOST_CHECK_EQUAL( st.size, vs.size() );
+	BOOST_CHECK_EQUAL( st.capacity, vs.capacity() );
+	BOOST_CHECK_EQUAL( st.peak_size, vs.size() );
+	BOOST_CHECK_EQUAL( st.size, st.payload_bytes + st.padding_bytes + st.header_bytes );
+
+	const size_t peak = vs.size();
+	vs.dealloc(s);
+	st = vs.stats();
+	BOOST_CHECK_EQUAL( st.chunks, 2u );
+	BOOST_CHECK_EQUAL( st.deallocations, 1u );
+	BOOST_CHECK_EQUAL( st.out_of_order_deallocations, 0u );
+	BOOST_CHECK_EQUAL( st.peak_size, peak );
+	BOOST_CHECK( st.size < peak );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_stats_blocked_chunks ) {
+	counting_obstack vs(default_size);
+
+	std::string *s1 = vs.alloc<std::string>("foo");
+	std::string *s2 = vs.alloc<std::string>("bar");
+	int *i1 = vs.alloc<int>(1);
+	BOOST_REQUIRE( s1 != NULL && s2 != NULL && i1 != NULL );
+
+	vs.dealloc(s1);
+	vs.dealloc(s2);
+	boost::arena::obstack_stats st = vs.stats();
+	BOOST_CHECK_EQUAL( st.out_of_order_deallocations, 2u );
+	BOOST_CHECK_EQUAL( st.blocked_chunks, 2u );
+	BOOST_CHECK_EQUAL( st.chunks, 3u );
+
+	vs.dealloc(i1);
+	st = vs.stats();
+	BOOST_CHECK_EQUAL( st.blocked_chunks, 0u );
+	BOOST_CHECK_EQUAL( st.chunks, 0u );
+	BOOST_CHECK_EQUAL( st.size, 0u );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_stats_rewind ) {
+	counting_obstack vs(default_size);
+
+	vs.alloc<int>(1);
+	const counting_obstack::marker m = vs.mark();
+	std::string *s1 = vs.alloc<std::string>("foo");
+	vs.alloc_array<char>(100);
+	vs.alloc_array<std::string>(3);
+	vs.alloc<int>(2);
+	vs.dealloc(s1);
+	BOOST_CHECK_EQUAL( vs.stats().chunks, 5u );
+	BOOST_CHECK_EQUAL( vs.stats().blocked_chunks, 1u );
+
+	vs.rewind_to(m);
+	boost::arena::obstack_stats st = vs.stats();
+	BOOST_CHECK_EQUAL( st.chunks, 1u );
+	BOOST_CHECK_EQUAL( st.blocked_chunks, 0u );
+	BOOST_CHECK_EQUAL( st.allocations, 5u );
+	BOOST_CHECK( st.header_bytes > 5*sizeof(void*) );
+
+	vs.dealloc_all();
+	st = vs.stats();
+	BOOST_CHECK_EQUAL( st.chunks, 0u );
+	BOOST_CHECK( st.peak_size > 100u );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_stats_extend_in_place ) {
+	counting_obstack vs(default_size);
+
+	char *a = vs.alloc_array<char>(16);
+	BOOST_REQUIRE( a != NULL );
+	const size_t size_before = vs.size();
+	BOOST_REQUIRE( vs.try_extend(a, 1000) );
+	BOOST_CHECK_EQUAL( vs.size(), size_before + 1000 - 16 );
+
+	boost::arena::obstack_stats st = vs.stats();
+	BOOST_CHECK_EQUAL( st.peak_size, vs.size() );
+	BOOST_CHECK_EQUAL( st.payload_bytes, 1000u );
+	BOOST_CHECK_EQUAL( st.allocations, 1u );
+
+	const size_t peak = vs.size();
+	vs.shrink_top(a, 10);
+	st = vs.stats();
+	BOOST_CHECK_EQUAL( st.peak_size, peak );
+	BOOST_CHECK_EQUAL( st.payload_bytes, 1000u );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_stats_disabled ) {
+	obstack vs(default_size);
+	vs.alloc<int>(1);
+	const boost::arena::obstack_stats st = vs.stats();
+	BOOST_CHECK_EQUAL( st.size, vs.size() );
+	BOOST_CHECK_EQUAL( st.allocations, 0u );
+	BOOST_CHECK( sizeof(obstack) < sizeof(counting_obstack) );
+}
+
+struct DtorCounter {
+	~DtorCounter() { _num_dtor_calls++; }
+};
+
+template<class Policy>
+static void check_security_policy() {
+	typedef boost::arena::basic_obstack<std::allocator<boost::arena::max_align_t>, boost::arena::null_stats, Policy> policy_obstack;
+	policy_obstack vs(default_size);
+	_num_dtor_calls = 0;
+
+	DtorCounter *d1 = vs.template alloc<DtorCounter>();
+	DtorCounter *d2 = vs.template alloc_array<DtorCounter>(3);
+	int *i1 = vs.template alloc<int>(1);
+	BOOST_REQUIRE( d1 != NULL && d2 != NULL && i1 != NULL );
+	BOOST_CHECK( vs.is_valid(d1) );
+	BOOST_CHECK( vs.is_top(i1) );
+
+	vs.dealloc(d1);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 1 );
+	vs.dealloc(i1);
+	vs.dealloc(d2);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 4 );
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+
+	vs.template alloc<DtorCounter>();
+	vs.template alloc_array<char>(10);
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 5 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_security_policies ) {
+	check_security_policy<boost::arena::security::hardened>();
+	check_security_policy<boost::arena::security::checksum_only>();
+	check_security_policy<boost::arena::security::none>();
+}
+
+BOOST_AUTO_TEST_CASE( concurrent_obstack_alloc ) {
+	boost::arena::concurrent_obstack vs(default_size);
+
+	char *c = vs.alloc<char>('a');
+	int *i = vs.alloc<int>(42);
+	double *d = vs.alloc_array<double>(10);
+	BOOST_REQUIRE( c != NULL && i != NULL && d != NULL );
+	BOOST_CHECK_EQUAL( *c, 'a' );
+	BOOST_CHECK_EQUAL( *i, 42 );
+	BOOST_CHECK( is_aligned(i) );
+	BOOST_CHECK_EQUAL( reinterpret_cast<size_t>(d) % boost::alignment_of<double>::value, 0u );
+	BOOST_CHECK_EQUAL( vs.size(), reinterpret_cast<char*>(d+10) - c );
+
+	BOOST_CHECK( vs.alloc_array<char>(default_size) == NULL );
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+	BOOST_CHECK( vs.alloc_array<char>(default_size) != NULL );
+	BOOST_CHECK( vs.alloc<char>() == NULL );
+}
+
+#ifndef BOOST_NO_CXX11_THREAD_LOCAL
+static void fill_concurrent_obstack(boost::arena::concurrent_obstack *obs, std::vector<int*> *out, int id) {
+	for(;;) {
+		int * const i = obs->alloc<int>(id);
+		if(!i) {
+			break;
+		}
+		out->push_back(i);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( concurrent_obstack_threads ) {
+	const size_t num_ints = 100000;
+	boost::arena::concurrent_obstack vs(num_ints*sizeof(int));
+	std::vector<int*> results[4];
+
+	std::vector<std::thread> threads;
+	for(int t=0; t<4; t++) {
+		threads.push_back(std::thread(fill_concurrent_obstack, &vs, &results[t], t));
+	}
+	for(size_t t=0; t<threads.size(); t++) {
+		threads[t].join();
+	}
+
+	size_t total = 0;
+	for(int t=0; t<4; t++) {
+		total += results[t].size();
+		for(size_t k=0; k<results[t].size(); k++) {
+			BOOST_REQUIRE_EQUAL( *results[t][k], t );
+		}
+	}
+	BOOST_CHECK_EQUAL( total, num_ints );
+	BOOST_CHECK_EQUAL( vs.size(), vs.capacity() );
+}
+#endif //BOOST_NO_CXX11_THREAD_LOCAL
+
+#ifdef BOOST_ARENA_HAS_NUMA
+typedef boost::arena::numa_allocator<boost::arena::max_align_t> test_numa_allocator;
+typedef boost::arena::basic_obstack<test_numa_allocator> numa_obstack;
+
+BOOST_AUTO_TEST_CASE( obstack_numa_allocator ) {
+	const int node = test_numa_allocator::current_node();
+	BOOST_CHECK( node >= 0 && node <= test_numa_allocator::max_node() );
+
+	numa_obstack local(default_size, test_numa_allocator(test_numa_allocator::local_node, boost::arena::mmap_options::populate));
+	numa_obstack bound(default_size, boost::arena::block_growth(), test_numa_allocator(node));
+
+	std::string *s = local.alloc<std::string>("foo");
+	BOOST_REQUIRE( s != NULL );
+	BOOST_CHECK_EQUAL( *s, "foo" );
+
+	for(int i=0; i<4; i++) {
+		char *c = bound.alloc_array<char>(default_size);
+		BOOST_REQUIRE( c != NULL );
+		c[default_size-1] = 42;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( numa_allocator_equality ) {
+	const test_numa_allocator local;
+	const test_numa_allocator bound(0);
+	BOOST_CHECK( local == test_numa_allocator() );
+	BOOST_CHECK( bound == boost::arena::numa_allocator<char>(bound) );
+	BOOST_CHECK( local != bound );
+	BOOST_CHECK( bound != test_numa_allocator(0, boost::arena::mmap_options::populate) );
+}
+#endif //BOOST_ARENA_HAS_NUMA
+
+//overwrites the complete chunk_header in front of a trivially destructible allocation
+static void scribble_chunk_header(void * const obj) {
+	char * const header = static_cast<char*>(obj) - 4*sizeof(void*);
+	std::memset(header, 0xab, 4*sizeof(void*));
+}
+
+BOOST_AUTO_TEST_CASE( obstack_teardown_skips_trivial_chunks ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	Sensor *s1 = vs.alloc<Sensor>();
+	BOOST_REQUIRE( s1 != NULL );
+	s1->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+	const boost::arena::obstack::marker m = vs.mark();
+	for(int i=0; i<10; i++) {
+		char *c = vs.alloc_array<char>(1000);
+		BOOST_REQUIRE( c != NULL );
+		int *n = vs.alloc<int>(i);
+		BOOST_REQUIRE( n != NULL );
+		scribble_chunk_header(c);
+		scribble_chunk_header(n);
+	}
+	Sensor *s2 = vs.alloc<Sensor>();
+	BOOST_REQUIRE( s2 != NULL );
+	s2->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+
+	vs.rewind_to(m);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 1 );
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 2 );
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+}
+
+#if !defined(BOOST_NO_CXX11_SMART_PTR) && !defined(BOOST_NO_CXX11_TEMPLATE_ALIASES) && defined(BOOST_ARENA_HAS_VARIADIC_ALLOC)
+BOOST_AUTO_TEST_CASE( obstack_unique_ptr ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	{
+		boost::arena::obstack_unique_ptr<Sensor> s1 = boost::arena::make_obstack_unique<Sensor>(vs);
+		BOOST_REQUIRE( s1 );
+		s1->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+		boost::arena::obstack_unique_ptr<std::string> s2 = boost::arena::make_obstack_unique<std::string>(vs, "foo");
+		BOOST_REQUIRE( s2 );
+		BOOST_CHECK_EQUAL( *s2, "foo" );
+
+		boost::arena::obstack_unique_ptr<Sensor> s3 = std::move(s1);
+		BOOST_CHECK( !s1 );
+		BOOST_CHECK_EQUAL( _num_dtor_calls, 0 );
+	}
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 1 );
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+
+	BOOST_CHECK( boost::arena::make_obstack_unique<char>(vs, 'x').get_deleter().get_arena() == &vs );
+	boost::arena::obstack_unique_ptr<boost::arena::max_align_t> empty;
+	BOOST_CHECK( !empty );
+}
+#endif
+
+BOOST_AUTO_TEST_CASE( obstack_shared_ptr ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	{
+		boost::shared_ptr<Sensor> s1 = boost::arena::make_obstack_shared<Sensor>(vs);
+		s1->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+		BOOST_CHECK( vs.size() > sizeof(Sensor) );
+
+		const size_t before_copy = vs.size();
+		boost::shared_ptr<Sensor> s2 = s1;
+		BOOST_CHECK_EQUAL( vs.size(), before_copy );
+
+		boost::shared_ptr<std::string> s3 = boost::arena::make_obstack_shared<std::string>(vs, "foo");
+		BOOST_CHECK_EQUAL( *s3, "foo" );
+	}
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 1 );
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+
+	obstack tiny(64);
+	BOOST_CHECK_THROW( boost::arena::make_obstack_shared<Sensor>(tiny), std::bad_alloc );
+}
+
+struct ThrowingDtor {
+	explicit ThrowingDtor(int id) : id(id) {}
+	~ThrowingDtor() BOOST_NOEXCEPT_IF(false) {
+		_num_dtor_calls++;
+		throw id;
+	}
+	int id;
+};
+
+BOOST_AUTO_TEST_CASE( obstack_dealloc_all_dtor_throws ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	BOOST_REQUIRE( vs.alloc<DtorCounter>() != NULL );
+	BOOST_REQUIRE( vs.alloc<ThrowingDtor>(1) != NULL );
+	BOOST_REQUIRE( vs.alloc<DtorCounter>() != NULL );
+	BOOST_REQUIRE( vs.alloc<ThrowingDtor>(2) != NULL );
+	BOOST_REQUIRE( vs.alloc<DtorCounter>() != NULL );
+
+	int thrown = 0;
+	try {
+		vs.dealloc_all();
+	} catch(int id) {
+		thrown = id;
+	}
+	BOOST_CHECK_EQUAL( thrown, 2 );
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 5 );
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 5 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_rewind_dtor_throws ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	BOOST_REQUIRE( vs.alloc<ThrowingDtor>(1) != NULL );
+	const size_t size_before = vs.size();
+	const boost::arena::obstack::marker m = vs.mark();
+	BOOST_REQUIRE( vs.alloc<ThrowingDtor>(2) != NULL );
+	BOOST_REQUIRE( vs.alloc<DtorCounter>() != NULL );
+	BOOST_REQUIRE( vs.alloc<ThrowingDtor>(3) != NULL );
+
+	BOOST_CHECK_THROW( vs.rewind_to(m), int );
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 3 );
+	BOOST_CHECK_EQUAL( vs.size(), size_before );
+
+	BOOST_CHECK_THROW( vs.dealloc_all(), int );
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 4 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_destructor_swallows_dtor_exceptions ) {
+	_num_dtor_calls = 0;
+	{
+		obstack vs(default_size);
+		BOOST_REQUIRE( vs.alloc<ThrowingDtor>(1) != NULL );
+		BOOST_REQUIRE( vs.alloc<DtorCounter>() != NULL );
+		BOOST_REQUIRE( vs.alloc<ThrowingDtor>(2) != NULL );
+	}
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 3 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_n ) {
+	obstack vs(default_size);
+
+	int *i = vs.alloc_n<int>(10);
+	BOOST_REQUIRE( i != NULL );
+	BOOST_CHECK( is_aligned(i) );
+	for(int k=0; k<10; k++) {
+		BOOST_CHECK_EQUAL( i[k], 0 );
+	}
+	BOOST_CHECK( vs.size() < boost::arena::obstack::max_overhead(1) + 10*sizeof(int) + sizeof(size_t) );
+
+	vs.dealloc(i);
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+	BOOST_CHECK( vs.alloc_n<int>(default_size) == NULL );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_batch ) {
+	_num_dtor_calls = 0;
+
+	obstack vs(default_size);
+	std::vector<DtorCounter*> batch;
+	DtorCounter *first = vs.alloc_batch<DtorCounter>(5, std::back_inserter(batch));
+	BOOST_REQUIRE( first != NULL );
+	BOOST_REQUIRE_EQUAL( batch.size(), 5u );
+	for(size_t k=0; k<batch.size(); k++) {
+		BOOST_CHECK_EQUAL( batch[k], first+k );
+	}
+
+	std::vector<double*> doubles;
+	BOOST_CHECK( vs.alloc_batch<double>(default_size, std::back_inserter(doubles)) == NULL );
+	BOOST_CHECK( doubles.empty() );
+
+	vs.dealloc(first);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 5 );
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+}
+
+typedef boost::arena::basic_obstack<
+	std::allocator<boost::arena::max_align_t>,
+	boost::arena::counting_stats,
+	boost::arena::security::hardened,
+	boost::arena::hole_reuse
+> hole_reuse_obstack;
+
+BOOST_AUTO_TEST_CASE( obstack_hole_reuse_alloc ) {
+	hole_reuse_obstack vs(default_size);
+
+	char *hole = vs.alloc_array<char>(64);
+	int *i1 = vs.alloc<int>(1);
+	BOOST_REQUIRE( hole != NULL && i1 != NULL );
+	vs.dealloc(hole, 64);
+	const size_t size = vs.size();
+
+	char *c = vs.alloc_array<char>(48);
+	BOOST_CHECK( c == hole );
+	BOOST_CHECK_EQUAL( vs.size(), size );
+	BOOST_CHECK( vs.is_valid(c) );
+	BOOST_CHECK_EQUAL( vs.stats().hole_reuses, 1u );
+	BOOST_CHECK_EQUAL( vs.stats().blocked_chunks, 0u );
+
+	//the hole is gone now
+	BOOST_CHECK( vs.alloc_array<char>(48) != hole );
+	BOOST_CHECK( vs.size() > size );
+
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+	BOOST_CHECK_EQUAL( vs.stats().chunks, 0u );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_hole_reuse_trivial_objects_only ) {
+	hole_reuse_obstack vs(default_size);
+
+	double *hole = vs.alloc_array<double>(8);
+	int *i1 = vs.alloc<int>(1);
+	BOOST_REQUIRE( hole != NULL && i1 != NULL );
+	vs.dealloc(hole, 8*sizeof(double));
+
+	std::string *s = vs.alloc<std::string>("foo");
+	BOOST_CHECK( reinterpret_cast<void*>(s) != reinterpret_cast<void*>(hole) );
+	double *d = vs.alloc<double>(4.2);
+	BOOST_CHECK( d == hole );
+	BOOST_CHECK( is_aligned(d) );
+	BOOST_CHECK_EQUAL( *d, 4.2 );
+
+	//the reused chunk is an ordinary chunk again
+	vs.dealloc(s);
+	vs.dealloc(i1);
+	vs.dealloc(d);
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_hole_reuse_reclaimed_holes ) {
+	hole_reuse_obstack vs(default_size);
+
+	char *hole = vs.alloc_array<char>(64);
+	int *i1 = vs.alloc<int>(1);
+	BOOST_REQUIRE( hole != NULL && i1 != NULL );
+	vs.dealloc(hole, 64);
+	vs.dealloc(i1);
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+
+	//the hole was reclaimed with the top of stack and must not be handed out again
+	char *c = vs.alloc_array<char>(48);
+	int *i2 = vs.alloc<int>(2);
+	BOOST_REQUIRE( c != NULL && i2 != NULL );
+	BOOST_CHECK_EQUAL( vs.stats().hole_reuses, 0u );
+
+	const hole_reuse_obstack::marker m = vs.mark();
+	char *hole2 = vs.alloc_array<char>(64);
+	vs.alloc<int>(3);
+	vs.dealloc(hole2, 64);
+	vs.rewind_to(m);
+	const size_t size = vs.size();
+	BOOST_CHECK( vs.alloc_array<char>(48) != NULL );
+	BOOST_CHECK_EQUAL( vs.stats().hole_reuses, 0u );
+	BOOST_CHECK( vs.size() > size );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_hole_reuse_grow_top_stays_on_top ) {
+	hole_reuse_obstack vs(1024, boost::arena::block_growth());
+
+	char *hole = vs.alloc_array<char>(700);
+	char *top = vs.alloc_array<char>(16);
+	BOOST_REQUIRE( hole != NULL && top != NULL );
+	std::memset(top, 'x', 16);
+	vs.dealloc(hole, 700);
+
+	char *grown = vs.grow_top(top, 400);
+	BOOST_REQUIRE( grown != NULL );
+	BOOST_CHECK( grown != hole );
+	BOOST_CHECK( vs.is_top(grown) );
+	BOOST_CHECK_EQUAL( grown[15], 'x' );
+	BOOST_CHECK_EQUAL( vs.stats().hole_reuses, 0u );
+	BOOST_CHECK( vs.try_extend(grown, 500) );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_hole_reuse_disabled ) {
+	obstack vs(default_size);
+
+	char *hole = vs.alloc_array<char>(64);
+	int *i1 = vs.alloc<int>(1);
+	BOOST_REQUIRE( hole != NULL && i1 != NULL );
+	vs.dealloc(hole, 64);
+	BOOST_CHECK( vs.alloc_array<char>(48) != hole );
+	BOOST_CHECK( sizeof(obstack) < sizeof(hole_reuse_obstack) );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_hole_reuse_allocator ) {
+	hole_reuse_obstack vs(default_size);
+	typedef boost::arena::obstack_allocator<int, hole_reuse_obstack> int_allocator;
+
+	//a vector leaves its old buffers behind when it grows, later vectors fill them
+	std::vector<int, int_allocator> v1((int_allocator(vs)));
+	vs.alloc<int>(0);
+	for(int k=0; k<64; k++) {
+		v1.push_back(k);
+	}
+	const size_t size = vs.size();
+	std::vector<int, int_allocator> v2((int_allocator(vs)));
+	v2.push_back(1);
+	v2.push_back(2);
+	BOOST_CHECK( vs.stats().hole_reuses > 0u );
+	BOOST_CHECK_EQUAL( vs.size(), size );
+}
+
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+struct ThrowingTrivialCtor {
+	explicit ThrowingTrivialCtor(bool do_throw) {
+		if(do_throw) {
+			throw std::runtime_error("ctor");
+		}
+	}
+	double values[4];
+};
+
+BOOST_AUTO_TEST_CASE( obstack_hole_reuse_ctor_throws ) {
+	hole_reuse_obstack vs(default_size);
+
+	double *hole = vs.alloc_array<double>(8);
+	int *i1 = vs.alloc<int>(1);
+	BOOST_REQUIRE( hole != NULL && i1 != NULL );
+	vs.dealloc(hole, 8*sizeof(double));
+
+	BOOST_CHECK_THROW( vs.alloc<ThrowingTrivialCtor>(true), std::runtime_error );
+	ThrowingTrivialCtor *t = vs.alloc<ThrowingTrivialCtor>(false);
+	BOOST_CHECK( reinterpret_cast<void*>(t) == reinterpret_cast<void*>(hole) );
+	BOOST_CHECK_EQUAL( vs.stats().blocked_chunks, 0u );
+}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+
+typedef boost::arena::trace_stats<8> small_trace;
+typedef boost::arena::basic_obstack<std::allocator<boost::arena::max_align_t>, small_trace> tracing_obstack;
+typedef boost::arena::trace_event trace_event;
+
+BOOST_AUTO_TEST_CASE( obstack_trace_records_operations ) {
+	tracing_obstack vs(default_size);
+
+	int *i1 = vs.alloc<int>(1);
+	const size_t before = vs.size();
+	double *d = vs.alloc<double>(4.2);
+	BOOST_REQUIRE( i1 != NULL && d != NULL );
+	vs.dealloc(i1);
+	vs.dealloc(d);
+
+	const small_trace &trace = vs.get_stats_policy();
+	BOOST_REQUIRE_EQUAL( trace.size(), 4u );
+	BOOST_CHECK_EQUAL( trace[0].kind, trace_event::allocate );
+	BOOST_CHECK_EQUAL( trace[0].object, reinterpret_cast<size_t>(i1) );
+	BOOST_CHECK_EQUAL( trace[0].size, sizeof(int) );
+	BOOST_CHECK_EQUAL( trace[0].position, 0u );
+	BOOST_CHECK_EQUAL( trace[1].object, reinterpret_cast<size_t>(d) );
+	BOOST_CHECK( trace[1].align >= boost::alignment_of<double>::value );
+	BOOST_CHECK_EQUAL( trace[1].position, before );
+	BOOST_CHECK_EQUAL( trace[2].kind, trace_event::dealloc );
+	BOOST_CHECK_EQUAL( trace[2].object, reinterpret_cast<size_t>(i1) );
+	BOOST_CHECK_EQUAL( trace[3].kind, trace_event::dealloc_top );
+	BOOST_CHECK( trace[0].timestamp <= trace[3].timestamp );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_trace_rewind_and_reset ) {
+	tracing_obstack vs(default_size);
+
+	vs.alloc<int>(1);
+	const tracing_obstack::marker m = vs.mark();
+	const size_t marked = vs.size();
+	vs.alloc<int>(2);
+	vs.rewind_to(m);
+	vs.dealloc_all();
+
+	const small_trace &trace = vs.get_stats_policy();
+	BOOST_REQUIRE_EQUAL( trace.size(), 4u );
+	BOOST_CHECK_EQUAL( trace[2].kind, trace_event::rewind );
+	BOOST_CHECK_EQUAL( trace[2].position, marked );
+	BOOST_CHECK_EQUAL( trace[3].kind, trace_event::reset );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_trace_ring_buffer ) {
+	tracing_obstack vs(default_size);
+
+	for(int k=0; k<10; k++) {
+		vs.alloc<int>(k);
+	}
+	int *last = vs.alloc<int>(10);
+
+	const small_trace &trace = vs.get_stats_policy();
+	BOOST_CHECK_EQUAL( trace.recorded(), 11u );
+	BOOST_REQUIRE_EQUAL( trace.size(), 8u );
+	BOOST_CHECK_EQUAL( trace[7].object, reinterpret_cast<size_t>(last) );
+	for(size_t k=1; k<trace.size(); k++) {
+		BOOST_CHECK( trace[k-1].object < trace[k].object );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( obstack_trace_write_read ) {
+	tracing_obstack vs(default_size);
+	std::string *s = vs.alloc<std::string>("foo");
+	vs.alloc_array<char>(100);
+	vs.dealloc(s);
+
+	std::stringstream buffer;
+	BOOST_REQUIRE( boost::arena::write_trace(buffer, vs.get_stats_policy()) );
+	std::vector<trace_event> events;
+	BOOST_REQUIRE( boost::arena::read_trace(buffer, events) );
+	BOOST_REQUIRE_EQUAL( events.size(), 3u );
+	BOOST_CHECK_EQUAL( events[1].size, 100u );
+	BOOST_CHECK_EQUAL( events[2].kind, trace_event::dealloc );
+	BOOST_CHECK_EQUAL( events[2].object, reinterpret_cast<size_t>(s) );
+
+	std::stringstream garbage("not a trace at all");
+	BOOST_CHECK( !boost::arena::read_trace(garbage, events) );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_trace_unallocate ) {
+	tracing_obstack vs(default_size);
+
+	BOOST_CHECK_THROW( vs.alloc<ThrowingCtor>(true), std::runtime_error );
+	const small_trace &trace = vs.get_stats_policy();
+	BOOST_REQUIRE_EQUAL( trace.size(), 2u );
+	BOOST_CHECK_EQUAL( trace[0].kind, trace_event::allocate );
+	BOOST_CHECK_EQUAL( trace[1].kind, trace_event::unallocate );
+	BOOST_CHECK_EQUAL( trace[1].object, trace[0].object );
+}
+
+typedef boost::arena::basic_obstack<
+	std::allocator<boost::arena::max_align_t>,
+	small_trace,
+	boost::arena::security::hardened,
+	boost::arena::hole_reuse
+> tracing_hole_reuse_obstack;
+
+BOOST_AUTO_TEST_CASE( obstack_trace_hole_reuse_rewind ) {
+	tracing_hole_reuse_obstack vs(default_size);
+
+	vs.alloc<int>(1);
+	const tracing_hole_reuse_obstack::marker m = vs.mark();
+	char *hole = vs.alloc_array<char>(64);
+	BOOST_REQUIRE( vs.alloc<int>(2) != NULL );
+	vs.dealloc(hole, 64);
+	vs.rewind_to(m);
+
+	//reclaiming the chunks above the marker is no constructor failure
+	const small_trace &trace = vs.get_stats_policy();
+	BOOST_REQUIRE_EQUAL( trace.size(), 5u );
+	BOOST_CHECK_EQUAL( trace[3].kind, trace_event::dealloc );
+	BOOST_CHECK_EQUAL( trace[4].kind, trace_event::rewind );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_trace_read_truncated ) {
+	tracing_obstack vs(default_size);
+	vs.alloc<int>(1);
+
+	std::stringstream buffer;
+	BOOST_REQUIRE( boost::arena::write_trace(buffer, vs.get_stats_policy()) );
+	std::string data = buffer.str();
+	//claim far more events than the stream holds
+	const boost::uint64_t count = static_cast<boost::uint64_t>(1) << 40;
+	std::memcpy(&data[8], &count, sizeof(count));
+
+	std::stringstream truncated(data);
+	std::vector<trace_event> events;
+	BOOST_CHECK( !boost::arena::read_trace(truncated, events) );
+	BOOST_CHECK( events.size() <= 4096u );
+}
+
+struct persistent_node {
+	boost::arena::persistent_obstack::offset_type next;
+	int value;
+};
+
+static void build_persistent_list(boost::arena::persistent_obstack &arena, int const num_nodes) {
+	persistent_node *head = NULL;
+	for(int k=0; k<num_nodes; k++) {
+		persistent_node * const n = arena.alloc<persistent_node>();
+		BOOST_REQUIRE( n != NULL );
+		n->value = k;
+		n->next = arena.to_offset(head);
+		head = n;
+	}
+	arena.set_root(head);
+}
+
+static int sum_persistent_list(const boost::arena::persistent_obstack &arena) {
+	int sum = 0;
+	for(const persistent_node *n = arena.root<persistent_node>(); n; n = arena.from_offset<persistent_node>(n->next)) {
+		BOOST_CHECK( arena.is_valid(n) );
+		sum += n->value;
+	}
+	return sum;
+}
+
+BOOST_AUTO_TEST_CASE( persistent_obstack_file_reload ) {
+	using boost::arena::persistent_obstack;
+	std::ostringstream path;
+	path << "/tmp/arena_test_persistent_" << getpid();
+
+	size_t size = 0;
+	{
+		persistent_obstack arena(path.str().c_str(), persistent_obstack::create, 64*1024);
+		BOOST_CHECK_EQUAL( arena.capacity(), 64*1024u );
+		build_persistent_list(arena, 10);
+		size = arena.size();
+		BOOST_CHECK( arena.flush() );
+	}
+	{
+		persistent_obstack arena(path.str().c_str(), persistent_obstack::open_existing);
+		BOOST_CHECK_EQUAL( arena.size(), size );
+		BOOST_CHECK_EQUAL( sum_persistent_list(arena), 45 );
+		BOOST_CHECK( arena.alloc_array<char>(100) != NULL );
+		BOOST_CHECK( arena.alloc_array<char>(64*1024) == NULL );
+	}
+	unlink(path.str().c_str());
+
+	BOOST_CHECK_THROW( persistent_obstack(path.str().c_str(), persistent_obstack::open_existing), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( persistent_obstack_relocate_image ) {
+	using boost::arena::persistent_obstack;
+	std::vector<boost::arena::max_align_t> image(1024);
+	std::vector<boost::arena::max_align_t> copy(1024);
+	const size_t image_size = image.size() * sizeof(boost::arena::max_align_t);
+	{
+		persistent_obstack arena(&image[0], image_size, persistent_obstack::create);
+		build_persistent_list(arena, 5);
+		std::memcpy(&copy[0], &image[0], image_size);
+	}
+	std::memset(&image[0], 0, image_size);
+
+	persistent_obstack arena(&copy[0], image_size, persistent_obstack::open_existing);
+	BOOST_CHECK( arena.data() == &copy[0] );
+	BOOST_CHECK_EQUAL( sum_persistent_list(arena), 10 );
+
+	BOOST_CHECK_THROW( persistent_obstack(&image[0], image_size, persistent_obstack::open_existing), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( persistent_obstack_dealloc ) {
+	using boost::arena::persistent_obstack;
+	std::vector<boost::arena::max_align_t> image(1024);
+	persistent_obstack arena(&image[0], image.size() * sizeof(boost::arena::max_align_t), persistent_obstack::create);
+	const size_t empty = arena.size();
+
+	double *d = arena.alloc<double>(4.2);
+	int *i = arena.alloc_array<int>(10);
+	BOOST_REQUIRE( d != NULL && i != NULL );
+	BOOST_CHECK( is_aligned(d) );
+	BOOST_CHECK( arena.is_valid(d) && arena.is_valid(i) );
+	BOOST_CHECK( !arena.is_valid(i + 9) );
+	BOOST_CHECK( !arena.is_valid(&image[1023]) );
+
+	const size_t full = arena.size();
+	arena.dealloc(d);
+	BOOST_CHECK_EQUAL( arena.size(), full );
+	arena.dealloc(i);
+	BOOST_CHECK_EQUAL( arena.size(), empty );
+
+	arena.alloc<int>(1);
+	const persistent_obstack::marker m = arena.mark();
+	const size_t marked = arena.size();
+	arena.alloc_array<char>(100);
+	arena.rewind_to(m);
+	BOOST_CHECK_EQUAL( arena.size(), marked );
+
+	arena.dealloc_all();
+	BOOST_CHECK_EQUAL( arena.size(), empty );
+	BOOST_CHECK( arena.root<int>() == NULL );
+}
+
+struct shm_message {
+	boost::uint32_t num_values;
+	boost::arena::shm_obstack::offset_type values;
+};
+
+static int read_shm_message(const char * const name, boost::arena::shm_obstack::offset_type const msg_offset) {
+	using boost::arena::shared_memory_segment;
+	shared_memory_segment segment(name, shared_memory_segment::open_existing);
+	boost::arena::shm_obstack_reader reader(segment);
+	const shm_message * const msg = reader.at<shm_message>(msg_offset);
+	if(!msg) {
+		return 1;
+	}
+	const int * const values = reader.at<int>(msg->values, msg->num_values);
+	if(!values || reader.at<int>(msg->values, msg->num_values + 1000) != NULL) {
+		return 2;
+	}
+	int sum = 0;
+	for(boost::uint32_t k=0; k<msg->num_values; k++) {
+		sum += values[k];
+	}
+	reader.release(reader.published());
+	return sum == 45 ? 0 : 3;
+}
+
+BOOST_AUTO_TEST_CASE( shm_obstack_handoff ) {
+	using boost::arena::shared_memory_segment;
+	using boost::arena::shm_obstack;
+	std::ostringstream name;
+	name << "/arena_test_shm_" << getpid();
+
+	shared_memory_segment segment(name.str().c_str(), shared_memory_segment::create, 64*1024);
+	shm_obstack writer(segment);
+	boost::arena::shm_obstack_reader reader(segment);
+	BOOST_CHECK( reader.at<int>(writer.offset_of(segment.data())) == NULL );
+
+	int * const values = writer.arena().alloc_array<int>(10);
+	shm_message * const msg = writer.arena().alloc<shm_message>();
+	BOOST_REQUIRE( values != NULL && msg != NULL );
+	for(int k=0; k<10; k++) {
+		values[k] = k;
+	}
+	msg->num_values = 10;
+	msg->values = writer.offset_of(values);
+	const shm_obstack::offset_type msg_offset = writer.offset_of(msg);
+	BOOST_CHECK( reader.at<shm_message>(msg_offset) == NULL );
+	BOOST_CHECK( !writer.is_valid(msg_offset) );
+
+	writer.publish();
+	BOOST_CHECK( writer.is_valid(msg_offset) );
+	BOOST_CHECK( !writer.is_valid(msg_offset + 1) );
+	BOOST_CHECK( reader.at<shm_message>(msg_offset) == msg );
+	BOOST_CHECK( reader.at<shm_message>(msg_offset + 1) == NULL );
+	BOOST_CHECK( !writer.reclaim() );
+
+	const pid_t pid = fork();
+	BOOST_REQUIRE( pid >= 0 );
+	if(pid == 0) {
+		_exit(read_shm_message(name.str().c_str(), msg_offset));
+	}
+	int status = 0;
+	BOOST_REQUIRE_EQUAL( waitpid(pid, &status, 0), pid );
+	BOOST_CHECK( WIFEXITED(status) );
+	BOOST_CHECK_EQUAL( WEXITSTATUS(status), 0 );
+
+	BOOST_CHECK( writer.reclaim() );
+	BOOST_CHECK_EQUAL( writer.arena().size(), 0u );
+	BOOST_CHECK( reader.at<shm_message>(msg_offset) == NULL );
+
+	//an offset of the previous epoch is rejected, even when the new one covers it
+	BOOST_CHECK_EQUAL( writer.epoch(), 1u );
+	int * const next = writer.arena().alloc_array<int>(64);
+	BOOST_REQUIRE( next != NULL );
+	writer.publish();
+	BOOST_CHECK( writer.offset_of(next) + 64*sizeof(int) > msg_offset + sizeof(shm_message) );
+	BOOST_CHECK( reader.at<shm_message>(msg_offset) == NULL );
+	reader.published();
+	BOOST_CHECK_EQUAL( reader.epoch(), 1u );
+	BOOST_CHECK( reader.at<int>(writer.offset_of(next), 64) == next );
+	BOOST_CHECK( shared_memory_segment::remove(name.str().c_str()) );
+
+	BOOST_CHECK_THROW( shared_memory_segment(name.str().c_str(), shared_memory_segment::open_existing), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( shm_obstack_segment_too_small ) {
+	using boost::arena::shared_memory_segment;
+	std::ostringstream name;
+	name << "/arena_test_shm_small_" << getpid();
+
+	shared_memory_segment segment(name.str().c_str(), shared_memory_segment::create, 16);
+	BOOST_CHECK_THROW( boost::arena::shm_obstack writer(segment), std::runtime_error );
+	BOOST_CHECK( shared_memory_segment::remove(name.str().c_str()) );
+}
+
+static bool is_aligned_to(const void * const p, size_t const align_to) {
+	return reinterpret_cast<size_t>(p) % align_to == 0;
+}
+
+struct simd_vector {
+	float lanes[16];
+};
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_aligned ) {
+	obstack vs(default_size);
+	vs.alloc<char>('x');
+	for(size_t align_to = 1; align_to <= 4096; align_to *= 2) {
+		int * const i = vs.alloc_aligned<int>(align_to, 42);
+		BOOST_REQUIRE( i != NULL );
+		BOOST_CHECK( is_aligned_to(i, align_to) );
+		BOOST_CHECK( is_aligned(i) );
+		BOOST_CHECK_EQUAL( *i, 42 );
+		BOOST_CHECK( vs.is_valid(i) && vs.is_top(i) );
+		vs.alloc<char>('y');
+	}
+
+	simd_vector * const v = vs.alloc_array_aligned<simd_vector>(10, 64);
+	BOOST_REQUIRE( v != NULL );
+	BOOST_CHECK( is_aligned_to(v, 64) );
+	BOOST_CHECK( vs.is_valid(v) );
+
+	_num_dtor_calls = 0;
+	DtorCounter * const d = vs.alloc_array_aligned<DtorCounter>(3, 128);
+	BOOST_REQUIRE( d != NULL );
+	BOOST_CHECK( is_aligned_to(d, 128) );
+	vs.dealloc(d);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 3 );
+
+	BOOST_CHECK( vs.alloc_array_aligned<char>(64*1024, 64) == NULL );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_aligned_pad_tail ) {
+	obstack vs(default_size);
+	const boost::arena::alignment_request line = boost::arena::alignment_request::cache_line();
+	int * const a = vs.alloc_aligned<int>(line, 1);
+	const size_t size_after_a = vs.size();
+	int * const b = vs.alloc_aligned<int>(line, 2);
+	BOOST_REQUIRE( a != NULL && b != NULL );
+	BOOST_CHECK( is_aligned_to(a, boost::arena::cache_line_size) );
+	BOOST_CHECK( is_aligned_to(b, boost::arena::cache_line_size) );
+	BOOST_CHECK( reinterpret_cast<char*>(b) - reinterpret_cast<char*>(a) >= 2*static_cast<ptrdiff_t>(boost::arena::cache_line_size) );
+
+	//the padded tail belongs to the chunk, the next chunk_header starts on a new line
+	char * const c = vs.alloc<char>('c');
+	BOOST_CHECK( c - reinterpret_cast<char*>(b) > static_cast<ptrdiff_t>(boost::arena::cache_line_size) );
+
+	vs.dealloc(c);
+	vs.dealloc(b);
+	BOOST_CHECK( vs.is_top(a) );
+
+	char * const s = vs.alloc_array_aligned<char>(10, boost::arena::alignment_request(256, true));
+	BOOST_REQUIRE( s != NULL );
+	BOOST_CHECK( is_aligned_to(s, 256) );
+	BOOST_CHECK( vs.size() - size_after_a >= 256 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_aligned_grows ) {
+	obstack vs(256, boost::arena::block_growth());
+	simd_vector * const v = vs.alloc_aligned<simd_vector>(4096);
+	BOOST_REQUIRE( v != NULL );
+	BOOST_CHECK( is_aligned_to(v, 4096) );
+	BOOST_CHECK( vs.is_top(v) );
+	vs.dealloc(v);
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_alloc_aligned_ctor_throws ) {
+	_num_dtor_calls = 0;
+	obstack vs(default_size);
+	const size_t size_before = vs.size();
+	BOOST_CHECK_THROW( vs.alloc_aligned<ThrowingCtor>(64, true), std::runtime_error );
+	BOOST_CHECK_EQUAL( vs.size(), size_before );
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_scratch_stack ) {
+	obstack vs(4096);
+	int * const result = vs.alloc<int>(1);
+	const size_t size_before = vs.size();
+
+	double * const d = vs.alloc_scratch<double>(2.5);
+	char * const buf = vs.alloc_scratch_array<char>(100);
+	BOOST_REQUIRE( d != NULL && buf != NULL );
+	BOOST_CHECK( is_aligned(d) );
+	BOOST_CHECK_EQUAL( *d, 2.5 );
+	BOOST_CHECK( vs.is_valid(d) && vs.is_valid(buf) );
+	BOOST_CHECK( buf < reinterpret_cast<char*>(d) );
+	BOOST_CHECK( reinterpret_cast<char*>(result) < buf );
+	BOOST_CHECK_EQUAL( vs.size(), size_before );
+	BOOST_CHECK( vs.scratch_size() > 100 + sizeof(double) );
+	BOOST_CHECK( vs.is_top(result) );
+
+	//the main stack keeps allocating, both share the free memory in between
+	int * const result2 = vs.alloc<int>(2);
+	BOOST_REQUIRE( result2 != NULL );
+	BOOST_CHECK( reinterpret_cast<char*>(result2) < buf );
+
+	vs.dealloc_all_scratch();
+	BOOST_CHECK_EQUAL( vs.scratch_size(), 0u );
+	BOOST_CHECK_EQUAL( *result, 1 );
+	BOOST_CHECK_EQUAL( *result2, 2 );
+	BOOST_CHECK( vs.is_top(result2) );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_scratch_shared_capacity ) {
+	obstack vs(1024);
+	int n = 0;
+	while(vs.alloc_scratch<int>(n)) {
+		n++;
+	}
+	BOOST_CHECK( n > 10 );
+	BOOST_CHECK( vs.alloc<int>() == NULL );
+
+	vs.dealloc_all_scratch();
+	int m = 0;
+	while(vs.alloc<int>(m)) {
+		m++;
+	}
+	BOOST_CHECK( m >= n - 1 );
+	BOOST_CHECK( vs.alloc_scratch<int>() == NULL );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_scratch_rewind ) {
+	_num_dtor_calls = 0;
+	obstack vs(default_size);
+	vs.alloc_scratch<DtorCounter>();
+	const boost::arena::obstack::scratch_marker m = vs.mark_scratch();
+	const size_t scratch_before = vs.scratch_size();
+	vs.alloc_scratch<DtorCounter>();
+	vs.alloc_scratch_array<DtorCounter>(3);
+	vs.alloc_scratch_array<int>(20);
+	Sensor * const s = vs.alloc<Sensor>();
+	BOOST_REQUIRE( s != NULL );
+
+	vs.rewind_scratch(m);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 4 );
+	BOOST_CHECK_EQUAL( vs.scratch_size(), scratch_before );
+	BOOST_CHECK( vs.is_top(s) );
+
+	vs.alloc_scratch<DtorCounter>();
+	vs.dealloc_all();
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 6 );
+	BOOST_CHECK_EQUAL( vs.scratch_size(), 0u );
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+
+	vs.alloc_scratch<DtorCounter>();
+}
+
+BOOST_AUTO_TEST_CASE( obstack_scratch_ctor_throws ) {
+	_num_dtor_calls = 0;
+	_num_ctor_calls = 0;
+	obstack vs(default_size);
+	vs.alloc_scratch<int>(1);
+	const size_t scratch_before = vs.scratch_size();
+	BOOST_CHECK_THROW( vs.alloc_scratch<ThrowingCtor>(true), std::runtime_error );
+	BOOST_CHECK_EQUAL( vs.scratch_size(), scratch_before );
+	BOOST_CHECK_THROW( vs.alloc_scratch_array<ThrowsOnFifth>(10), std::runtime_error );
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 4 );
+	BOOST_CHECK_EQUAL( vs.scratch_size(), scratch_before );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_scratch_blocks_growth ) {
+	obstack vs(256, boost::arena::block_growth());
+	BOOST_REQUIRE( vs.alloc_scratch<int>(1) != NULL );
+	BOOST_CHECK( vs.alloc_array<char>(1024) == NULL );
+	vs.dealloc_all_scratch();
+	BOOST_CHECK( vs.alloc_array<char>(1024) != NULL );
+	BOOST_CHECK( vs.alloc_scratch<int>(1) == NULL );
+	vs.dealloc_all();
+	BOOST_CHECK( vs.alloc_scratch<int>(1) != NULL );
+}
+
+BOOST_AUTO_TEST_CASE( ring_obstack_pipelined_lifetimes ) {
+	typedef boost::arena::ring_obstack<3> ring_type;
+	ring_type ring(4096);
+	BOOST_CHECK_EQUAL( ring.size(), 0u );
+
+	std::vector<int*> per_frame;
+	for(int f=0; f<3; f++) {
+		int * const i = ring.frame().alloc<int>(f);
+		BOOST_REQUIRE( i != NULL );
+		per_frame.push_back(i);
+		ring.next_frame();
+	}
+	BOOST_CHECK_EQUAL( ring.frame_number(), 3u );
+
+	//frame 0 is recycled, frames 1 and 2 are still alive
+	BOOST_CHECK_EQUAL( ring.frame().size(), 0u );
+	BOOST_CHECK_EQUAL( *per_frame[1], 1 );
+	BOOST_CHECK_EQUAL( *per_frame[2], 2 );
+	BOOST_CHECK( ring.frame(1).is_valid(per_frame[2]) );
+	BOOST_CHECK( ring.frame(2).is_valid(per_frame[1]) );
+
+	int * const j = ring.frame().alloc<int>(3);
+	BOOST_CHECK( j == per_frame[0] );
+
+	BOOST_CHECK( ring.frame().alloc_array<char>(4096) == NULL );
+	BOOST_CHECK( ring.frame().alloc_array<char>(2048) != NULL );
+}
+
+BOOST_AUTO_TEST_CASE( ring_obstack_destructs_oldest_frame ) {
+	_num_dtor_calls = 0;
+	{
+		boost::arena::ring_obstack<2> ring(1024);
+		ring.frame().alloc<DtorCounter>();
+		ring.frame().alloc<DtorCounter>();
+		ring.next_frame();
+		BOOST_CHECK_EQUAL( _num_dtor_calls, 0 );
+		ring.frame().alloc_array<DtorCounter>(3);
+		ring.next_frame();
+		BOOST_CHECK_EQUAL( _num_dtor_calls, 2 );
+		ring.frame().alloc<DtorCounter>();
+	}
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 6 );
+}
+
+struct typed_token {
+	int id;
+	char kind;
+};
+
+struct sum_token_ids {
+	sum_token_ids() : sum(0), num_ranges(0) {}
+	void operator()(const typed_token &t) { sum += t.id; }
+	void operator()(const typed_token * const begin, const typed_token * const end) {
+		num_ranges++;
+		for(const typed_token *t = begin; t != end; ++t) {
+			sum += t->id;
+		}
+	}
+	int sum;
+	int num_ranges;
+};
+
+BOOST_AUTO_TEST_CASE( typed_obstack_contiguous_regions ) {
+	typedef boost::arena::typed_obstack<typed_token, double, std::string> typed_type;
+	typed_type arena(4096, 4);
+
+	std::vector<typed_token*> tokens;
+	for(int k=0; k<100; k++) {
+		typed_token t = { k, 'a' };
+		typed_token * const p = arena.alloc<typed_token>(t);
+		BOOST_REQUIRE( p != NULL );
+		tokens.push_back(p);
+		BOOST_REQUIRE( arena.alloc<double>(k * 0.5) != NULL );
+	}
+	BOOST_CHECK_EQUAL( arena.count<typed_token>(), 100u );
+	BOOST_CHECK_EQUAL( arena.count<double>(), 100u );
+	BOOST_CHECK_EQUAL( arena.count<std::string>(), 0u );
+
+	//the first segment holds 4 tokens back to back, the following ones double
+	BOOST_CHECK_EQUAL( tokens[1] - tokens[0], 1 );
+	BOOST_CHECK_EQUAL( tokens[3] - tokens[0], 3 );
+	BOOST_CHECK_EQUAL( tokens[11] - tokens[4], 7 );
+	for(int k=0; k<100; k++) {
+		BOOST_CHECK_EQUAL( tokens[k]->id, k );
+	}
+
+	const sum_token_ids by_object = arena.for_each<typed_token>(sum_token_ids());
+	BOOST_CHECK_EQUAL( by_object.sum, 4950 );
+	const sum_token_ids by_segment = arena.for_each_segment<typed_token>(sum_token_ids());
+	BOOST_CHECK_EQUAL( by_segment.sum, 4950 );
+	BOOST_CHECK_EQUAL( by_segment.num_ranges, 5 );
+
+	//cleared segments are reused
+	arena.clear<typed_token>();
+	BOOST_CHECK_EQUAL( arena.count<typed_token>(), 0u );
+	BOOST_CHECK_EQUAL( arena.for_each<typed_token>(sum_token_ids()).sum, 0 );
+	typed_token t = { 7, 'b' };
+	BOOST_CHECK( arena.alloc<typed_token>(t) == tokens[0] );
+	BOOST_CHECK_EQUAL( arena.count<double>(), 100u );
+}
+
+BOOST_AUTO_TEST_CASE( typed_obstack_destructs ) {
+	_num_dtor_calls = 0;
+	{
+		boost::arena::typed_obstack<DtorCounter, std::string> arena(1024);
+		for(int k=0; k<10; k++) {
+			BOOST_REQUIRE( arena.alloc<DtorCounter>() != NULL );
+		}
+		std::string * const s = arena.alloc<std::string>("a string that does not fit into the small string buffer");
+		BOOST_REQUIRE( s != NULL );
+		arena.clear<DtorCounter>();
+		BOOST_CHECK_EQUAL( _num_dtor_calls, 10 );
+		arena.alloc<DtorCounter>();
+		arena.alloc<DtorCounter>();
+	}
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 12 );
+
+	boost::arena::typed_obstack<int> ints(256);
+	for(int k=0; k<1000; k++) {
+		BOOST_REQUIRE( ints.alloc<int>(k) != NULL );
+	}
+	ints.dealloc_all();
+	BOOST_CHECK_EQUAL( ints.count<int>(), 0u );
+	BOOST_CHECK_EQUAL( ints.size(), 0u );
+	BOOST_CHECK( ints.alloc<int>(1) != NULL );
+}
+
+BOOST_AUTO_TEST_CASE( typed_obstack_failed_segment_is_reclaimed ) {
+	//the storage of the first segment cannot be allocated, the segment header must not stay behind
+	boost::arena::typed_obstack<int> ints(256, std::size_t(1) << 40);
+	for(int k=0; k<10; k++) {
+		BOOST_CHECK( ints.alloc<int>(k) == NULL );
+	}
+	BOOST_CHECK_EQUAL( ints.count<int>(), 0u );
+	BOOST_CHECK_EQUAL( ints.size(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_vector_grows_on_top ) {
+	obstack vs(default_size);
+	boost::arena::obstack_vector<int> v(vs);
+	BOOST_CHECK( v.empty() );
+	BOOST_REQUIRE( v.push_back(0) );
+	const int * const first = v.data();
+	for(int k=1; k<1000; k++) {
+		BOOST_REQUIRE( v.push_back(k) );
+	}
+	//the buffer stayed on top and was extended in place
+	BOOST_CHECK( v.data() == first );
+	BOOST_CHECK_EQUAL( v.size(), 1000u );
+	BOOST_CHECK( v.capacity() >= 1000u );
+	BOOST_CHECK( vs.size() <= v.capacity()*sizeof(int) + boost::arena::obstack::max_overhead(1) );
+	int sum = 0;
+	for(boost::arena::obstack_vector<int>::const_iterator i = v.begin(); i != v.end(); ++i) {
+		sum += *i;
+	}
+	BOOST_CHECK_EQUAL( sum, 499500 );
+	v.pop_back();
+	BOOST_CHECK_EQUAL( v.back(), 998 );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_vector_moves_when_not_on_top ) {
+	_num_dtor_calls = 0;
+	obstack vs(default_size);
+	{
+		boost::arena::obstack_vector<std::string> v(vs);
+		BOOST_REQUIRE( v.push_back("a") );
+		const std::string * const first = v.data();
+		vs.alloc<DtorCounter>();
+		for(int k=0; k<20; k++) {
+			BOOST_REQUIRE( v.push_back("b") );
+		}
+		BOOST_CHECK( v.data() != first );
+		BOOST_CHECK_EQUAL( v.size(), 21u );
+		BOOST_CHECK_EQUAL( v[0], "a" );
+		BOOST_CHECK_EQUAL( v[20], "b" );
+	}
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 0 );
+
+	obstack small(1024);
+	boost::arena::obstack_vector<char> c(small);
+	BOOST_CHECK( !c.reserve(4096) );
+	BOOST_CHECK_EQUAL( c.capacity(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_list_push_pop ) {
+	obstack vs(default_size);
+	boost::arena::obstack_list<std::string> l(vs);
+	BOOST_CHECK( l.empty() );
+	BOOST_REQUIRE( l.push_back("b") != NULL );
+	BOOST_REQUIRE( l.push_back("c") != NULL );
+	BOOST_REQUIRE( l.push_front("a") != NULL );
+	BOOST_CHECK_EQUAL( l.size(), 3u );
+
+	std::string joined;
+	for(boost::arena::obstack_list<std::string>::const_iterator i = l.begin(); i != l.end(); ++i) {
+		joined += *i;
+	}
+	BOOST_CHECK_EQUAL( joined, "abc" );
+	BOOST_CHECK_EQUAL( l.front(), "a" );
+	BOOST_CHECK_EQUAL( l.back(), "c" );
+
+	l.pop_front();
+	l.pop_front();
+	BOOST_CHECK_EQUAL( l.front(), "c" );
+	l.pop_front();
+	BOOST_CHECK( l.empty() );
+	BOOST_CHECK_EQUAL( vs.size(), 0u );
+}
+
+struct sum_map_values {
+	sum_map_values() : sum(0) {}
+	void operator()(const std::pair<const int, int> &kv) { sum += kv.second; }
+	int sum;
+};
+
+BOOST_AUTO_TEST_CASE( obstack_hash_map_insert_find_erase ) {
+	obstack vs(default_size);
+	boost::arena::obstack_hash_map<int, int> m(vs);
+	BOOST_CHECK( m.find(1) == NULL );
+	for(int k=0; k<1000; k++) {
+		int * const v = m.insert(k, 2*k);
+		BOOST_REQUIRE( v != NULL );
+		BOOST_CHECK_EQUAL( *v, 2*k );
+	}
+	BOOST_CHECK_EQUAL( m.size(), 1000u );
+	BOOST_CHECK( 4*m.size() <= 3*m.capacity() );
+	BOOST_CHECK_EQUAL( *m.insert(5, 0), 10 );
+	for(int k=0; k<1000; k++) {
+		const int * const v = m.find(k);
+		BOOST_REQUIRE( v != NULL );
+		BOOST_CHECK_EQUAL( *v, 2*k );
+	}
+	BOOST_CHECK( m.find(1000) == NULL );
+	BOOST_CHECK_EQUAL( m.for_each(sum_map_values()).sum, 999000 );
+
+	for(int k=0; k<1000; k+=2) {
+		BOOST_CHECK( m.erase(k) );
+	}
+	BOOST_CHECK( !m.erase(0) );
+	BOOST_CHECK_EQUAL( m.size(), 500u );
+	BOOST_CHECK( m.find(2) == NULL );
+	BOOST_CHECK( m.find(3) != NULL );
+
+	//tombstones are reused and dropped on rehash, the table does not grow without bound
+	const size_t capacity = m.capacity();
+	for(int round=0; round<10; round++) {
+		for(int k=0; k<1000; k+=2) {
+			BOOST_REQUIRE( m.insert(k, k) != NULL );
+		}
+		for(int k=0; k<1000; k+=2) {
+			BOOST_CHECK( m.erase(k) );
+		}
+	}
+	BOOST_CHECK_EQUAL( m.capacity(), capacity );
+
+	m.clear();
+	BOOST_CHECK( m.empty() );
+	BOOST_CHECK( m.find(3) == NULL );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_hash_map_strings ) {
+	obstack vs(default_size);
+	{
+		boost::arena::obstack_hash_map<std::string, std::string> m(vs, 100);
+		BOOST_CHECK_EQUAL( m.capacity(), 0u );
+		BOOST_REQUIRE( m.insert("first", "entry") != NULL );
+		const size_t capacity = m.capacity();
+		for(int k=0; k<99; k++) {
+			std::ostringstream key;
+			key << "key" << k;
+			BOOST_REQUIRE( m.insert(key.str(), key.str() + " value that does not fit into a short string") != NULL );
+		}
+		BOOST_CHECK_EQUAL( m.capacity(), capacity );
+		BOOST_REQUIRE( m.find("key42") != NULL );
+		BOOST_CHECK_EQUAL( m.find("key42")->substr(0, 5), "key42" );
+	}
+
+	obstack small(512);
+	boost::arena::obstack_hash_map<int, int> m(small, 1000);
+	BOOST_CHECK( m.insert(1, 1) == NULL );
+	BOOST_CHECK( m.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_make_child ) {
+	_num_dtor_calls = 0;
+
+	obstack parent(default_size);
+	const size_t parent_size = parent.size();
+	boost::arena::obstack::child_type *child = parent.make_child(default_size/2);
+	BOOST_REQUIRE( child != NULL );
+	BOOST_CHECK( parent.is_top(child) );
+	BOOST_CHECK_EQUAL( child->capacity(), default_size/2 );
+
+	Sensor *s1 = child->alloc<Sensor>();
+	BOOST_REQUIRE( s1 != NULL );
+	s1->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+	BOOST_CHECK( is_aligned(s1) );
+	BOOST_CHECK( child->alloc_array<char>(default_size/2) == NULL );
+
+	boost::arena::obstack::child_type *grandchild = child->make_child(100);
+	BOOST_REQUIRE( grandchild != NULL );
+	Sensor *s2 = grandchild->alloc<Sensor>();
+	BOOST_REQUIRE( s2 != NULL );
+	s2->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+
+	parent.dealloc(child);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 2 );
+	BOOST_CHECK_EQUAL( parent.size(), parent_size );
+
+	BOOST_CHECK( parent.make_child(default_size) == NULL );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_make_child_rewind ) {
+	_num_dtor_calls = 0;
+
+	obstack parent(default_size);
+	const boost::arena::obstack::marker m = parent.mark();
+	for(int i=0; i<4; i++) {
+		boost::arena::obstack::child_type *child = parent.make_child(1000);
+		BOOST_REQUIRE( child != NULL );
+		Sensor *s = child->alloc<Sensor>();
+		BOOST_REQUIRE( s != NULL );
+		s->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+	}
+	parent.rewind_to(m);
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 4 );
+	BOOST_CHECK_EQUAL( parent.size(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( obstack_nesting ) {
+
+	_num_dtor_calls = 0;
+
+	{
+		obstack l1(default_size);
+		obstack *l2 = l1.alloc<obstack>(default_size);
+		BOOST_REQUIRE( l2 != NULL );
+		obstack *l3 = l2->alloc<obstack>(default_size);
+		BOOST_REQUIRE( l3 != NULL );
+		
+		
+		Sensor *s1 = l1.alloc<Sensor>();
+		BOOST_REQUIRE( s1 != NULL);
+		Sensor *s2 = l3->alloc<Sensor>();
+		BOOST_REQUIRE( s2 != NULL);
+
+		s1->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+		s2->set_dtor_callback(&obstack_dtor_called_on_scope_exit_func);
+	}
+
+
+	BOOST_CHECK_EQUAL( _num_dtor_calls, 2 );
+}
+
 
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,254 @@
+#ifndef BOOST_ARENA_BUMP_OBSTACK_HPP
+#define BOOST_ARENA_BUMP_OBSTACK_HPP
+
+#include <cstddef>
+#include <memory>
+
+#include <boost/utility.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+#include <boost/type_traits/is_pod.hpp>
+#include <boost/static_assert.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+#include "max_alignment_type.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \class bump_obstack
+ * \brief A header-less obstack for trivially destructible types
+ *
+ * A bump_obstack works like an obstack, but does not place a chunk_header
+ * in front of the objects. Allocating an object is only aligning and bumping
+ * the top of stack pointer, objects are packed as densly as their alignment allows.
+ *
+ * Since there are no destructors to call, only trivially destructible
+ * types can be allocated. Without headers, single objects cannot be freed.
+ * Instead the top of stack can be saved with mark() and later be rewound
+ * to with rewind_to(), or the whole obstack can be reset with dealloc_all().
+ *
+ * The memory layout looks like this:
+ *
+ *         |padding    |padding
+ * | object || object  || object | object |
+ * ____________________________________________..._____
+ * |        ||         ||        |        |           |
+ * --------------------------------------------...-----
+ * ^                                      ^           ^
+ * mem                                    tos         end_of_mem
+ *
+ */
+template<class A>
+class basic_bump_obstack
+	: private noncopyable
+{
+private:
+	typedef arena_detail::block_chain<A> holder_type;
+public:
+	typedef A allocator_type;
+	typedef typename holder_type::size_type size_type;
+	typedef typename holder_type::byte_type byte_type;
+
+	/**
+	 * \brief a saved top of stack position
+	 */
+	class marker {
+	public:
+		marker() : tos(NULL), size(0) {}
+	private:
+		friend class basic_bump_obstack;
+		marker(byte_type * const tos, size_type const size) : tos(tos), size(size) {}
+		byte_type *tos;
+		///the size at the time of marking, tells the marker's block apart from an adjacent one
+		size_type size;
+	};
+
+	/**
+	 * \brief rewinds the bump_obstack to the position it had on construction when going out of scope
+	 */
+	class scoped_checkpoint
+		: private noncopyable
+	{
+	public:
+		explicit scoped_checkpoint(basic_bump_obstack &obs) :
+			obs(obs),
+			m(obs.mark())
+		{}
+		~scoped_checkpoint() {
+			obs.rewind_to(m);
+		}
+	private:
+		basic_bump_obstack &obs;
+		marker const m;
+	};
+
+	/**
+	 * \brief construct a bump_obstack of a given capacity on the heap
+	 */
+	explicit basic_bump_obstack(size_type const capacity, const allocator_type &a = allocator_type()) :
+		memory(capacity, a, block_growth::none())
+	{
+		BOOST_ASSERT_MSG(capacity, "bump_obstack with capacity of 0 requested");
+		tos = memory.mem();
+	}
+
+	/**
+	 * \brief construct a growable bump_obstack with an initial block of a given capacity
+	 */
+	basic_bump_obstack(size_type const capacity, const block_growth &growth, const allocator_type &a = allocator_type()) :
+		memory(capacity, a, growth)
+	{
+		BOOST_ASSERT_MSG(capacity, "bump_obstack with capacity of 0 requested");
+		tos = memory.mem();
+	}
+
+	/**
+	 * \brief construct a bump_obstack on the given memory buffer
+	 *
+	 * The bump_obstack will free the memory using the supplied allocator.
+	 */
+	basic_bump_obstack(max_align_t *buffer, size_type const buffer_size, const allocator_type &a) :
+		memory(
+			buffer && buffer_size ? buffer : NULL,
+			buffer_size,
+			a,
+			block_growth::none())
+	{
+		BOOST_ASSERT_MSG(buffer, "supplied buffer is NULL");
+		BOOST_ASSERT_MSG(buffer_size, "supplied buffer_size is 0");
+		tos = memory.mem();
+	}
+
+	/**
+	 * \brief Allocate and value-initialize an object of type T
+	 *
+	 * T must be trivially destructible since no destructor will ever be called.
+	 * With C++11 the arguments are perfectly forwarded to the constructor of T,
+	 * otherwise at most one const argument is supported.
+	 */
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+	template<typename T, typename... Args>
+	T* alloc(Args&&... args) {
+		BOOST_STATIC_ASSERT_MSG( has_trivial_destructor<T>::value, "T must be trivially destructible.");
+		byte_type * const p = bump(alignment_of<T>::value, sizeof(T));
+		return p ? new(p) T(std::forward<Args>(args)...) : NULL;
+	}
+#else
+	template<typename T>
+	T* alloc() {
+		BOOST_STATIC_ASSERT_MSG( has_trivial_destructor<T>::value, "T must be trivially destructible.");
+		byte_type * const p = bump(alignment_of<T>::value, sizeof(T));
+		return p ? new(p) T() : NULL;
+	}
+	template<typename T, typename T1>
+	T* alloc(const T1 &a1) {
+		BOOST_STATIC_ASSERT_MSG( has_trivial_destructor<T>::value, "T must be trivially destructible.");
+		byte_type * const p = bump(alignment_of<T>::value, sizeof(T));
+		return p ? new(p) T(a1) : NULL;
+	}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+
+	/**
+	 * \brief Allocate a linear packed array of uninitialized elements
+	 *
+	 * T must be a POD type since there is no cunstructor called.
+	 */
+	template<typename T>
+	T* alloc_array(size_type const num_elements) {
+		BOOST_STATIC_ASSERT_MSG( is_pod<T>::value, "T must be a POD type.");
+		return alloc_storage<T>(num_elements);
+	}
+
+	/**
+	 * \brief Allocate uninitialized storage for a linear packed array of elements
+	 *
+	 * Unlike alloc_array, T may be any type. The caller is responsible
+	 * for constructing and destructing the elements.
+	 */
+	template<typename T>
+	T* alloc_storage(size_type const num_elements) {
+		return reinterpret_cast<T*>(bump(alignment_of<T>::value, sizeof(T)*num_elements));
+	}
+
+	/**
+	 * \brief reclaim the memory of an allocation of size bytes if it is the top of stack
+	 *
+	 * Allocations that are not on the top of stack stay blocked until the
+	 * bump_obstack is rewound below them.
+	 */
+	void dealloc(void * const p, size_type const size) {
+		if(p && static_cast<byte_type*>(p) + size == tos) {
+			tos = static_cast<byte_type*>(p);
+		}
+	}
+
+	///save the current top of stack
+	marker mark() const { return marker(tos, size()); }
+
+	/**
+	 * \brief free all objects allocated after the marker has been taken
+	 *
+	 * complexity: O(1), O(b) when b chained blocks are released
+	 */
+	void rewind_to(const marker &m) {
+		BOOST_ASSERT_MSG(m.tos, "rewind to an empty marker");
+		while(memory.is_chained() && (memory.used_below() > m.size || !is_in_current_block(m.tos))) {
+			tos = memory.pop_block();
+		}
+		BOOST_ASSERT_MSG(is_in_current_block(m.tos) && m.tos <= tos, "rewind to an invalid marker");
+		tos = m.tos;
+	}
+
+	///free all objects
+	void dealloc_all() {
+		while(memory.is_chained()) {
+			memory.pop_block();
+		}
+		tos = memory.mem();
+	}
+
+	///get the number of bytes that are already allocated
+	size_type size() const { return memory.used_below() + static_cast<size_type>(tos-memory.mem()); }
+	///get the number of bytes that are available in the bump_obstack in total
+	size_type capacity() const { return memory.capacity(); }
+
+	///give cached but unused memory blocks back to the allocator
+	void trim() { memory.trim(); }
+
+private:
+	byte_type* bump(size_type const align_to, size_type const size) {
+		byte_type * const p = tos + arena_detail::offset_to_alignment(tos, align_to);
+		if(p + size <= memory.end_of_mem()) {
+			tos = p + size;
+			return p;
+		} else {
+			return grow_and_bump(align_to, size);
+		}
+	}
+
+	byte_type* grow_and_bump(size_type const align_to, size_type const size) {
+		if(memory.push_block(tos, align_to + size)) {
+			tos = memory.mem();
+			return bump(align_to, size);
+		} else {
+			return NULL;
+		}
+	}
+
+	bool is_in_current_block(const byte_type * const p) const {
+		return p >= memory.mem() && p <= memory.end_of_mem();
+	}
+
+	///top of stack pointer
+	byte_type* tos;
+	holder_type memory;
+};
+
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_BUMP_OBSTACK_HPP
@@ -0,0 +1,165 @@
+#ifndef BOOST_ARENA_CONCURRENT_OBSTACK_HPP
+#define BOOST_ARENA_CONCURRENT_OBSTACK_HPP
+
+#include <cstddef>
+#include <memory>
+
+#include <boost/atomic.hpp>
+#include <boost/utility.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+#include <boost/type_traits/is_pod.hpp>
+#include <boost/static_assert.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+#include "max_alignment_type.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \class concurrent_obstack
+ * \brief A header-less fixed-capacity arena that many threads can allocate from at the same time
+ *
+ * Like a bump_obstack, a concurrent_obstack places no chunk_header in front of
+ * the objects and only supports trivially destructible types.
+ * The top of stack pointer is atomic: alloc aligns and bumps it with a
+ * compare-and-swap loop, so concurrent allocations neither lock nor block each other.
+ *
+ * Memory is released in bulk only: there is no dealloc of single objects and
+ * no marker, dealloc_all resets the whole arena. dealloc_all must not run
+ * concurrently with allocations, e.g. call it after joining the producer threads.
+ *
+ * The arena does not grow, allocations return NULL when it is full.
+ */
+template<class A>
+class basic_concurrent_obstack
+	: private noncopyable
+{
+private:
+	typedef arena_detail::octet_holder<A> holder_type;
+public:
+	typedef A allocator_type;
+	typedef typename holder_type::size_type size_type;
+	typedef typename holder_type::byte_type byte_type;
+
+	/**
+	 * \brief construct a concurrent_obstack of a given capacity on the heap
+	 */
+	explicit basic_concurrent_obstack(size_type const capacity, const allocator_type &a = allocator_type()) :
+		memory(capacity, a),
+		tos(memory.mem())
+	{
+		BOOST_ASSERT_MSG(capacity, "concurrent_obstack with capacity of 0 requested");
+	}
+
+	/**
+	 * \brief construct a concurrent_obstack on the given memory buffer
+	 *
+	 * The concurrent_obstack will free the memory using the supplied allocator.
+	 */
+	basic_concurrent_obstack(max_align_t *buffer, size_type const buffer_size, const allocator_type &a) :
+		memory(buffer, buffer_size, a),
+		tos(memory.mem())
+	{
+		BOOST_ASSERT_MSG(buffer, "supplied buffer is NULL");
+		BOOST_ASSERT_MSG(buffer_size, "supplied buffer_size is 0");
+	}
+
+	/**
+	 * \brief Allocate and construct an object of type T
+	 *
+	 * T must be trivially destructible since no destructor will ever be called.
+	 * With C++11 the arguments are perfectly forwarded to the constructor of T,
+	 * otherwise at most one const argument is supported.
+	 * Safe to call from any number of threads at the same time.
+	 */
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+	template<typename T, typename... Args>
+	T* alloc(Args&&... args) {
+		BOOST_STATIC_ASSERT_MSG( has_trivial_destructor<T>::value, "T must be trivially destructible.");
+		byte_type * const p = bump(alignment_of<T>::value, sizeof(T));
+		return p ? new(p) T(std::forward<Args>(args)...) : NULL;
+	}
+#else
+	template<typename T>
+	T* alloc() {
+		BOOST_STATIC_ASSERT_MSG( has_trivial_destructor<T>::value, "T must be trivially destructible.");
+		byte_type * const p = bump(alignment_of<T>::value, sizeof(T));
+		return p ? new(p) T() : NULL;
+	}
+	template<typename T, typename T1>
+	T* alloc(const T1 &a1) {
+		BOOST_STATIC_ASSERT_MSG( has_trivial_destructor<T>::value, "T must be trivially destructible.");
+		byte_type * const p = bump(alignment_of<T>::value, sizeof(T));
+		return p ? new(p) T(a1) : NULL;
+	}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+
+	/**
+	 * \brief Allocate a linear packed array of uninitialized elements
+	 *
+	 * T must be a POD type since there is no cunstructor called.
+	 * Safe to call from any number of threads at the same time.
+	 */
+	template<typename T>
+	T* alloc_array(size_type const num_elements) {
+		BOOST_STATIC_ASSERT_MSG( is_pod<T>::value, "T must be a POD type.");
+		return alloc_storage<T>(num_elements);
+	}
+
+	/**
+	 * \brief Allocate uninitialized storage for a linear packed array of elements
+	 *
+	 * The caller is responsible for constructing and destructing the elements.
+	 */
+	template<typename T>
+	T* alloc_storage(size_type const num_elements) {
+		return reinterpret_cast<T*>(bump(alignment_of<T>::value, sizeof(T)*num_elements));
+	}
+
+	/**
+	 * \brief free all objects
+	 *
+	 * Not thread safe: no other thread may allocate while the arena is reset.
+	 */
+	void dealloc_all() {
+		tos.store(memory.mem(), boost::memory_order_release);
+	}
+
+	///get the number of bytes that are already allocated
+	size_type size() const {
+		return static_cast<size_type>(tos.load(boost::memory_order_relaxed) - memory.mem());
+	}
+	///get the number of bytes that are available in the concurrent_obstack in total
+	size_type capacity() const { return memory.capacity(); }
+
+private:
+	/**
+	 * \brief atomically align and advance the top of stack, NULL when the arena is full
+	 *
+	 * complexity: O(1) without contention, retried once per concurrent winner otherwise
+	 */
+	byte_type* bump(size_type const align_to, size_type const size) {
+		byte_type *old_tos = tos.load(boost::memory_order_relaxed);
+		byte_type *p = NULL;
+		do {
+			p = old_tos + arena_detail::offset_to_alignment(old_tos, align_to);
+			if(p > memory.end_of_mem() || size > static_cast<size_type>(memory.end_of_mem() - p)) {
+				return NULL;
+			}
+		} while(!tos.compare_exchange_weak(old_tos, p + size, boost::memory_order_relaxed));
+		return p;
+	}
+
+	holder_type memory;
+	///top of stack pointer
+	boost::atomic<byte_type*> tos;
+};
+
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_CONCURRENT_OBSTACK_HPP
@@ -0,0 +1,143 @@
+#ifndef BOOST_ARENA_MMAP_ALLOCATOR_HPP
+#define BOOST_ARENA_MMAP_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <boost/limits.hpp>
+#include <boost/throw_exception.hpp>
+
+namespace boost {
+namespace arena {
+
+/**
+ * \brief options for the memory an mmap_allocator maps
+ */
+struct mmap_options {
+	enum flags {
+		///plain anonymous private mapping with the default page size
+		none = 0,
+		///map explicit huge pages (MAP_HUGETLB), fall back to normal pages if there are none left
+		huge_pages = 1,
+		///ask the kernel to back the mapping with transparent huge pages (MADV_HUGEPAGE)
+		transparent_huge_pages = 2,
+		///prefault all pages on allocation (MAP_POPULATE) to avoid first-touch faults later
+		populate = 4,
+		///only reserve address space without swap space behind it (MAP_NORESERVE), for arenas far larger than their use
+		reserve = 8
+	};
+};
+
+/**
+ * \brief an allocator that maps memory directly from the operating system
+ *
+ * Every allocation is a separate anonymous mapping, rounded up to the page size
+ * and released with munmap. This is meant for large, long-lived arena blocks:
+ * the memory can be backed with huge pages to reduce TLB misses and can be
+ * prefaulted to move page faults out of the first pass over the arena.
+ * Without prefaulting, pages are committed on first touch; together with
+ * basic_obstack::decommit a huge reserved arena only costs the pages in use.
+ * With huge pages requested, sizes are rounded up to huge_page_size.
+ */
+template<typename T>
+struct mmap_allocator {
+	typedef T         value_type;
+	typedef T*        pointer;
+	typedef T&        reference;
+	typedef const T*  const_pointer;
+	typedef const T&  const_reference;
+	typedef size_t    size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U>
+	struct rebind {
+		typedef mmap_allocator<U> other;
+	};
+
+	///the size of explicit huge pages, 2MB on x86-64
+	static size_type huge_page_size() { return 2*1024*1024; }
+
+	explicit mmap_allocator(int const options = mmap_options::none) : options(options) {}
+
+	template<typename U>
+	mmap_allocator(const mmap_allocator<U> &other) : options(other.get_options()) {}
+
+	int get_options() const { return options; }
+
+	pointer        address(reference x) const { return &x; }
+	const_pointer  address(const_reference x) const { return &x; }
+
+	pointer allocate(size_type n, const void * /*hint*/ = 0) {
+		const size_type bytes = mapping_size(n);
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+		if(options & mmap_options::populate) {
+			flags |= MAP_POPULATE;
+		}
+#endif
+#ifdef MAP_NORESERVE
+		if(options & mmap_options::reserve) {
+			flags |= MAP_NORESERVE;
+		}
+#endif
+
+		void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		if(options & mmap_options::huge_pages) {
+			p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+		}
+#endif
+		if(p == MAP_FAILED) {
+			p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+		}
+		if(p == MAP_FAILED) {
+			boost::throw_exception(std::bad_alloc());
+		}
+
+#ifdef MADV_HUGEPAGE
+		if(options & mmap_options::transparent_huge_pages) {
+			madvise(p, bytes, MADV_HUGEPAGE);
+		}
+#endif
+		return static_cast<pointer>(p);
+	}
+
+	void deallocate(pointer p, size_type n) {
+		if(p) {
+			munmap(p, mapping_size(n));
+		}
+	}
+
+	size_type      max_size() const throw() { return std::numeric_limits<size_type>::max() / sizeof(T); }
+	void           construct(pointer p, const_reference val) { new((void*)p) T(val); }
+	void           destroy(pointer p) { ((T*)p)->~T(); }
+
+private:
+	size_type mapping_size(size_type const n) const {
+		const size_type page = (options & mmap_options::huge_pages) ?
+			huge_page_size() : static_cast<size_type>(sysconf(_SC_PAGESIZE));
+		const size_type bytes = n*sizeof(T);
+		return bytes % page ? bytes + (page - bytes%page) : bytes;
+	}
+
+	int options;
+};
+
+///memory can only be released by an allocator with the same options, the mapping size depends on them
+template<typename T, typename U>
+inline bool operator==(const mmap_allocator<T> &lhs, const mmap_allocator<U> &rhs) {
+	return lhs.get_options() == rhs.get_options();
+}
+
+template<typename T, typename U>
+inline bool operator!=(const mmap_allocator<T> &lhs, const mmap_allocator<U> &rhs) {
+	return !(lhs == rhs);
+}
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_MMAP_ALLOCATOR_HPP
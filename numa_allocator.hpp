@@ -0,0 +1,130 @@
+#ifndef BOOST_ARENA_NUMA_ALLOCATOR_HPP
+#define BOOST_ARENA_NUMA_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+
+#include <numa.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <boost/limits.hpp>
+
+#include "mmap_allocator.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \brief an allocator that places its memory on a NUMA node
+ *
+ * Memory is mapped like with mmap_allocator and then bound to the node with
+ * libnuma before any page is touched, so the arena stays on that node no matter
+ * which thread faults it in first. With local_node, the memory is bound
+ * to the node of the cpu the allocating thread runs on.
+ * The populate option prefaults the pages after binding them.
+ *
+ * On systems without NUMA support the memory is not bound at all.
+ * Link with -lnuma.
+ */
+template<typename T>
+struct numa_allocator {
+	typedef T         value_type;
+	typedef T*        pointer;
+	typedef T&        reference;
+	typedef const T*  const_pointer;
+	typedef const T&  const_reference;
+	typedef size_t    size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U>
+	struct rebind {
+		typedef numa_allocator<U> other;
+	};
+
+	///bind to the node of the allocating thread
+	enum { local_node = -1 };
+
+	explicit numa_allocator(int const node = local_node, int const options = mmap_options::none) :
+		node(node),
+		options(options)
+	{}
+
+	template<typename U>
+	numa_allocator(const numa_allocator<U> &other) :
+		node(other.get_node()),
+		options(other.get_options())
+	{}
+
+	int get_node() const { return node; }
+	int get_options() const { return options; }
+
+	///true when the system supports NUMA
+	static bool is_available() { return numa_available() >= 0; }
+	///number of the highest NUMA node, 0 without NUMA support
+	static int max_node() { return is_available() ? numa_max_node() : 0; }
+	///the node of the cpu the calling thread runs on, 0 without NUMA support
+	static int current_node() {
+		if(!is_available()) {
+			return 0;
+		}
+		const int cpu = sched_getcpu();
+		const int n = cpu >= 0 ? numa_node_of_cpu(cpu) : -1;
+		return n >= 0 ? n : 0;
+	}
+
+	pointer        address(reference x) const { return &x; }
+	const_pointer  address(const_reference x) const { return &x; }
+
+	pointer allocate(size_type n, const void * /*hint*/ = 0) {
+		pointer const p = mapper().allocate(n);
+		const size_type bytes = n*sizeof(T);
+		if(is_available()) {
+			numa_tonode_memory(p, bytes, node == local_node ? current_node() : node);
+		}
+		if(options & mmap_options::populate) {
+			prefault(reinterpret_cast<volatile char*>(p), bytes);
+		}
+		return p;
+	}
+
+	void deallocate(pointer p, size_type n) {
+		mapper().deallocate(p, n);
+	}
+
+	size_type      max_size() const throw() { return std::numeric_limits<size_type>::max() / sizeof(T); }
+	void           construct(pointer p, const_reference val) { new((void*)p) T(val); }
+	void           destroy(pointer p) { ((T*)p)->~T(); }
+
+private:
+	///pages must not be populated before they are bound
+	mmap_allocator<T> mapper() const {
+		return mmap_allocator<T>(options & ~mmap_options::populate);
+	}
+
+	static void prefault(volatile char * const p, size_type const bytes) {
+		const size_type page = static_cast<size_type>(sysconf(_SC_PAGESIZE));
+		for(size_type i=0; i<bytes; i+=page) {
+			p[i] = 0;
+		}
+	}
+
+	int node;
+	int options;
+};
+
+///allocators are only interchangeable when they bind to the same node with the same options
+template<typename T, typename U>
+inline bool operator==(const numa_allocator<T> &lhs, const numa_allocator<U> &rhs) {
+	return lhs.get_node() == rhs.get_node() && lhs.get_options() == rhs.get_options();
+}
+
+template<typename T, typename U>
+inline bool operator!=(const numa_allocator<T> &lhs, const numa_allocator<U> &rhs) {
+	return !(lhs == rhs);
+}
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_NUMA_ALLOCATOR_HPP
@@ -1,6 +1,12 @@
 #include <limits>
 #include <cstdlib>
 
+#include <boost/config.hpp>
+#ifdef BOOST_HAS_UNISTD_H
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int.hpp>
 
@@ -15,6 +21,24 @@ void free_marker_dtor(void*) {
 }
 void array_of_primitives_dtor(void*) {
 }
+void hole_marker_dtor(void*) {
+}
+
+std::size_t decommit_pages(void * const begin, void * const end) {
+#if defined(BOOST_HAS_UNISTD_H) && defined(MADV_DONTNEED)
+	const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+	const std::size_t first = (reinterpret_cast<std::size_t>(begin) + page - 1) & ~(page - 1);
+	const std::size_t last = reinterpret_cast<std::size_t>(end) & ~(page - 1);
+	if(first >= last) {
+		return 0;
+	}
+	return madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED) == 0 ? last - first : 0;
+#else
+	(void)begin;
+	(void)end;
+	return 0;
+#endif
+}
 
 static size_t seed_from_heap_memory() {
 	size_t const len = 64*1024 / sizeof(size_t);
@@ -60,6 +84,7 @@ void * const ptr_sec::_invalid_addr = &invalid_addr_reference;
 //warning: initialization order is important here
 dtor_fptr const free_marker_dtor_xor = ptr_sec::xor_ptr(&free_marker_dtor);
 dtor_fptr const array_of_primitives_dtor_xor = ptr_sec::xor_ptr(&array_of_primitives_dtor);
+dtor_fptr const hole_marker_dtor_xor = ptr_sec::xor_ptr(&hole_marker_dtor);
 
 
 
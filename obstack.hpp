@@ -1,32 +1,129 @@
 #ifndef BOOST_OBSTACK_HPP
 #define BOOST_OBSTACK_HPP
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <new>
 
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
 #include <boost/utility.hpp>
 #include <boost/type_traits/alignment_of.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
 #include <boost/type_traits/is_pod.hpp>
 #include <boost/static_assert.hpp>
 
 #include "obstack_fwd.hpp"
+#include "obstack_stats.hpp"
+#include "obstack_hole_reuse.hpp"
 #include "max_alignment_type.hpp"
+#include "null_allocator.hpp"
+
+#if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES) && !defined(BOOST_NO_CXX11_RVALUE_REFERENCES)
+#define BOOST_ARENA_HAS_VARIADIC_ALLOC
+#include <utility>
+#endif
+
+#if defined(__GNUC__)
+#define BOOST_ARENA_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define BOOST_ARENA_PREFETCH(p)
+#endif
 
 namespace boost {
 namespace arena {
+
+/**
+ * \brief describes how an obstack chains additional memory blocks when it runs full
+ *
+ * Every new block is factor times the size of the previous one, but
+ * not larger than max_block_size (0 means no limit). Requests that do not fit
+ * into such a block get a block of their own.
+ * The sum of all block sizes, including the headers of chained blocks,
+ * never exceeds max_capacity (0 means no limit).
+ * A factor of 0 disables growth: the obstack stays a single fixed-capacity region.
+ */
+struct block_growth {
+	std::size_t factor;
+	std::size_t max_block_size;
+	std::size_t max_capacity;
+
+	explicit block_growth(
+		std::size_t const factor = 2,
+		std::size_t const max_block_size = 0,
+		std::size_t const max_capacity = 0
+	) :
+		factor(factor),
+		max_block_size(max_block_size),
+		max_capacity(max_capacity)
+	{}
+
+	static block_growth none() { return block_growth(0); }
+	bool enabled() const { return factor != 0; }
+};
+
+///the cache line size assumed by alignment_request::cache_line()
+static const std::size_t cache_line_size = 64;
+
+/**
+ * \brief an alignment for alloc_aligned and alloc_array_aligned
+ *
+ * align_to is a power of two and may exceed the alignment of max_align_t,
+ * e.g. a cache line, an AVX-512 register or a page. At most align_to-1 bytes of
+ * padding are spent in front of the allocation. With pad_tail, the allocation is rounded up to a
+ * multiple of align_to, so nothing else shares its last cache line or page.
+ */
+struct alignment_request {
+	std::size_t align_to;
+	bool pad_tail;
+
+	alignment_request(std::size_t const align_to, bool const pad_tail = false) :
+		align_to(align_to),
+		pad_tail(pad_tail)
+	{}
+
+	///a cache line of its own, e.g. for per-thread counters that must not be falsely shared
+	static alignment_request cache_line() { return alignment_request(cache_line_size, true); }
+};
+
 namespace arena_detail {
 
+/**
+ * \brief calculate the required padding bytes to the next fully aligned pointer
+ *
+ * Alignments are powers of two, so this is a negation and a mask.
+ * With a compile-time align_to, no division and no branch is left.
+ */
+inline std::size_t offset_to_alignment(const void * const p, const std::size_t align_to) {
+	BOOST_ASSERT_MSG((align_to & (align_to-1)) == 0, "alignment is not a power of two");
+	const std::size_t address = reinterpret_cast<std::size_t>(p);
+	return (0 - address) & (align_to - 1);
+}
+
 template<class T>
 void call_dtor(void *p) {
 	static_cast<T*>(p)->~T();
 }
 
+/**
+ * \brief give the whole pages between begin and end back to the operating system
+ *
+ * The memory stays mapped and reads as zeros after the next touch.
+ * Returns the number of bytes released, 0 where madvise is not available.
+ */
+std::size_t decommit_pages(void *begin, void *end);
+
 void free_marker_dtor(void*);
 void array_of_primitives_dtor(void*);
+void hole_marker_dtor(void*);
 
 typedef void (*dtor_fptr)(void*);
 extern dtor_fptr const free_marker_dtor_xor;
 extern dtor_fptr const array_of_primitives_dtor_xor;
+extern dtor_fptr const hole_marker_dtor_xor;
 extern size_t const checksum_cookie;
 
 
@@ -95,6 +192,7 @@ struct memory_holder {
 		}
 	}
 
+	allocator_type get_allocator() const { return allocator; }
 	pointer mem() const { return memory; }
 	pointer end_of_mem() const { return memory+memory_count; }
 	size_type capacity() const { return memory_count; }
@@ -123,8 +221,8 @@ struct octet_holder {
 		"the allocator and memory must be of max_align_t type"
 	);
 
-	octet_holder(alloc_pointer mem, alloc_size_type const capacity, allocator_type const &a) :
-		mem_holder(mem, capacity, a)
+	octet_holder(alloc_pointer mem, size_type const capacity_in_bytes, allocator_type const &a) :
+		mem_holder(mem, capacity_in_bytes / sizeof(alloc_value_type), a)
 	{
 		BOOST_ASSERT_MSG( is_aligned(mem), "memory alignment error");
 	}
@@ -134,10 +232,11 @@ struct octet_holder {
 	{}
 
 
+	allocator_type get_allocator() const { return mem_holder.get_allocator(); }
 	pointer mem() const { return to_byte_ptr(mem_holder.mem()); }
 	pointer end_of_mem() const { return to_byte_ptr(mem_holder.end_of_mem()); }
 	size_type capacity() const { return mem_holder.capacity() * sizeof(alloc_value_type); }
-private:
+
 	static alloc_size_type to_alloc_capacity(size_type const capacity_in_bytes) {
 		const alloc_size_type num_elements =
 			capacity_in_bytes / sizeof(alloc_value_type) + 
@@ -148,6 +247,7 @@ private:
 	static pointer to_byte_ptr(alloc_pointer const p) {
 		return reinterpret_cast<pointer>(p);
 	}
+private:
 
 	static bool is_aligned(void *p) {
 		return reinterpret_cast<size_t>(p) % alignment_of<max_align_t>::value == 0;
@@ -157,8 +257,333 @@ private:
 };
 
 
+/**
+ * \brief a stack of memory blocks: the initial octet_holder plus blocks chained on demand
+ *
+ * Chained blocks are requested from the allocator and start with a block_header
+ * that links them to the block below and remembers where the top of stack
+ * was when the block was pushed.
+ * One released block is kept as a spare to avoid hitting the allocator
+ * when the top of stack oscillates around a block boundary.
+ */
+template<typename A>
+struct block_chain
+	: private noncopyable
+{
+	typedef A allocator_type;
+	typedef octet_holder<allocator_type> holder_type;
+	typedef typename holder_type::byte_type byte_type;
+	typedef typename holder_type::size_type size_type;
+	typedef typename holder_type::pointer pointer;
+	typedef typename holder_type::alloc_size_type alloc_size_type;
+	typedef typename holder_type::alloc_value_type alloc_value_type;
+	typedef typename holder_type::alloc_pointer alloc_pointer;
+
+	block_chain(alloc_pointer mem, size_type const capacity_in_bytes, allocator_type const &a, block_growth const &g) :
+		first(mem, capacity_in_bytes, a),
+		growth(g),
+		top_block(NULL),
+		spare_block(NULL),
+		begin(first.mem()),
+		end(first.end_of_mem()),
+		total_capacity(first.capacity()),
+		num_blocks(0)
+	{}
+
+	block_chain(size_type const capacity_in_bytes, allocator_type const &a, block_growth const &g) :
+		first(capacity_in_bytes, a),
+		growth(g),
+		top_block(NULL),
+		spare_block(NULL),
+		begin(first.mem()),
+		end(first.end_of_mem()),
+		total_capacity(first.capacity()),
+		num_blocks(0)
+	{}
+
+	~block_chain() {
+		while(top_block) {
+			pop_block();
+		}
+		trim();
+	}
+
+	///begin of the current block
+	pointer mem() const { return begin; }
+	///end of the current block, or the bottom of a scratch stack growing down from it
+	pointer end_of_mem() const { return end; }
+	///end of the current block regardless of a scratch stack
+	pointer end_of_block() const { return top_block ? data_of(top_block) + top_block->data_size : first.end_of_mem(); }
+	///move the end of the current block, used by the scratch stack of basic_obstack
+	void set_end_of_mem(pointer const e) {
+		BOOST_ASSERT_MSG(e >= begin && e <= end_of_block(), "end outside of the current block");
+		end = e;
+	}
+	///sum of the sizes of all blocks
+	size_type capacity() const { return total_capacity; }
+	///bytes occupied in all blocks below the current one
+	size_type used_below() const { return top_block ? top_block->used_below : 0; }
+	///true when the current block is a chained one
+	bool is_chained() const { return top_block != NULL; }
+	///bytes a chained block needs in addition to its data
+	static size_type block_overhead() { return header_size; }
+
+	bool contains(const void * const p) const {
+		if(is_inside(p, first.mem(), first.end_of_mem())) {
+			return true;
+		}
+		for(const block_header *b = top_block; b; b = b->prev) {
+			if(is_inside(p, data_of(b), data_of(b) + b->data_size)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * \brief make a block with at least min_bytes of space the current block
+	 *
+	 * tos is the top of stack in the current block, it is restored by pop_block.
+	 * Returns false when growth is disabled, exhausted or the allocator failed.
+	 */
+	bool push_block(pointer const tos, size_type const min_bytes) {
+		if(!growth.enabled()) {
+			return false;
+		}
+
+		block_header *b = NULL;
+		if(spare_block && spare_block->data_size >= min_bytes && spare_block->data_size <= capacity_left()) {
+			b = spare_block;
+			spare_block = NULL;
+		} else {
+			const size_type data_size = next_block_size(min_bytes);
+			if(!data_size) {
+				return false;
+			}
+			b = allocate_block(data_size);
+			if(!b) {
+				return false;
+			}
+		}
+
+		b->prev = top_block;
+		b->saved_tos = tos;
+		b->used_below = used_below() + static_cast<size_type>(tos - begin);
+		top_block = b;
+		total_capacity += b->data_size;
+		num_blocks++;
+		begin = data_of(b);
+		end = begin + b->data_size;
+		return true;
+	}
+
+	/**
+	 * \brief release the current block and return the top of stack of the block below
+	 */
+	pointer pop_block() {
+		BOOST_ASSERT_MSG(top_block, "pop_block on the initial block");
+		block_header *b = top_block;
+		pointer const tos = b->saved_tos;
+		top_block = b->prev;
+		total_capacity -= b->data_size;
+		num_blocks--;
+		if(top_block) {
+			begin = data_of(top_block);
+			end = begin + top_block->data_size;
+		} else {
+			begin = first.mem();
+			end = first.end_of_mem();
+		}
+
+		if(spare_block) {
+			if(spare_block->data_size < b->data_size) {
+				std::swap(spare_block, b);
+			}
+			deallocate_block(b);
+		} else {
+			spare_block = b;
+		}
+		return tos;
+	}
+
+	///give the spare block back to the allocator
+	void trim() {
+		if(spare_block) {
+			deallocate_block(spare_block);
+			spare_block = NULL;
+		}
+	}
+
+private:
+	struct block_header {
+		block_header *prev;
+		pointer saved_tos;
+		size_type used_below;
+		size_type data_size;
+		alloc_size_type alloc_count;
+	};
+
+	enum {
+		header_size = sizeof(block_header) % sizeof(alloc_value_type) ?
+			sizeof(block_header) + (sizeof(alloc_value_type) - sizeof(block_header)%sizeof(alloc_value_type))
+			: sizeof(block_header)
+	};
+
+	static bool is_inside(const void * const p, const byte_type * const b, const byte_type * const e) {
+		return static_cast<const byte_type*>(p) >= b && static_cast<const byte_type*>(p) <= e;
+	}
+
+	static pointer data_of(block_header * const b) {
+		return reinterpret_cast<pointer>(b) + header_size;
+	}
+	static const byte_type* data_of(const block_header * const b) {
+		return reinterpret_cast<const byte_type*>(b) + header_size;
+	}
+
+	/**
+	 * \brief size of the next block following the geometric growth, 0 if the capacity is exhausted
+	 */
+	size_type next_block_size(size_type const min_bytes) const {
+		const size_type current_size = static_cast<size_type>(end - begin);
+		size_type size = current_size * growth.factor;
+		if(growth.max_block_size && size > growth.max_block_size) {
+			size = growth.max_block_size;
+		}
+		if(size < min_bytes) {
+			size = min_bytes;
+		}
+		const size_type left = capacity_left();
+		if(min_bytes > left) {
+			return 0;
+		}
+		return size > left ? left : size;
+	}
+
+	/**
+	 * \brief data bytes the next chained block may have without exceeding max_capacity
+	 *
+	 * The headers of all chained blocks, the next one included, count against the limit.
+	 * The result is a multiple of the allocation unit, so rounding in allocate_block cannot exceed it.
+	 */
+	size_type capacity_left() const {
+		if(!growth.max_capacity) {
+			return std::numeric_limits<size_type>::max();
+		}
+		const size_type used = total_capacity + (num_blocks+1)*header_size;
+		if(used >= growth.max_capacity) {
+			return 0;
+		}
+		const size_type left = growth.max_capacity - used;
+		return left - left%sizeof(alloc_value_type);
+	}
+
+	block_header* allocate_block(size_type const data_size) {
+		const alloc_size_type count = holder_type::to_alloc_capacity(header_size + data_size);
+		allocator_type a = first.get_allocator();
+		block_header *b = NULL;
+		try {
+			b = reinterpret_cast<block_header*>(a.allocate(count));
+		} catch(std::bad_alloc&) {
+			return NULL;
+		}
+		if(b) {
+			b->alloc_count = count;
+			b->data_size = count*sizeof(alloc_value_type) - header_size;
+		}
+		return b;
+	}
+
+	void deallocate_block(block_header * const b) {
+		allocator_type a = first.get_allocator();
+		a.deallocate(reinterpret_cast<alloc_pointer>(b), b->alloc_count);
+	}
+
+	holder_type first;
+	block_growth const growth;
+	block_header *top_block;
+	block_header *spare_block;
+	pointer begin;
+	pointer end;
+	size_type total_capacity;
+	///number of chained blocks, each costs header_size in addition to its data
+	size_type num_blocks;
+};
+
+
 } //namespace arena_detail
 
+/**
+ * \brief security policies for basic_obstack
+ *
+ * A security policy decides how destructor pointers are stored in the
+ * chunk_headers and how much a chunk_header is verified before its
+ * destructor is called on dealloc:
+ *	- hardened: encrypted destructor pointers, checksums, bounds checks
+ *	- checksum_only: plain destructor pointers, checksums
+ *	- none: plain destructor pointers, no checks at all
+ *
+ * Only use checksum_only or none for arenas that never see untrusted input.
+ */
+namespace security {
+
+struct hardened {
+	enum {
+		verify_bounds = 1,
+		verify_checksum = 1
+	};
+
+	static arena_detail::dtor_fptr encode(arena_detail::dtor_fptr const dtor) { return arena_detail::ptr_sec::xor_ptr(dtor); }
+	static arena_detail::dtor_fptr decode(arena_detail::dtor_fptr const dtor) { return arena_detail::ptr_sec::xor_ptr(dtor); }
+	static arena_detail::dtor_fptr free_marker() { return arena_detail::free_marker_dtor_xor; }
+	static arena_detail::dtor_fptr trivial_marker() { return arena_detail::array_of_primitives_dtor_xor; }
+	static arena_detail::dtor_fptr hole_marker() { return arena_detail::hole_marker_dtor_xor; }
+
+	static size_t make_checksum(const void * const prev, arena_detail::dtor_fptr const dtor) {
+		return arena_detail::ptr_sec::make_checksum(prev, dtor);
+	}
+	static bool checksum_ok(const void * const prev, arena_detail::dtor_fptr const dtor, size_t const checksum) {
+		return arena_detail::ptr_sec::checksum_ok(prev, dtor, checksum);
+	}
+};
+
+struct checksum_only {
+	enum {
+		verify_bounds = 0,
+		verify_checksum = 1
+	};
+
+	static arena_detail::dtor_fptr encode(arena_detail::dtor_fptr const dtor) { return dtor; }
+	static arena_detail::dtor_fptr decode(arena_detail::dtor_fptr const dtor) { return dtor; }
+	static arena_detail::dtor_fptr free_marker() { return &arena_detail::free_marker_dtor; }
+	static arena_detail::dtor_fptr trivial_marker() { return &arena_detail::array_of_primitives_dtor; }
+	static arena_detail::dtor_fptr hole_marker() { return &arena_detail::hole_marker_dtor; }
+
+	static size_t make_checksum(const void * const prev, arena_detail::dtor_fptr const dtor) {
+		return arena_detail::ptr_sec::make_checksum(prev, dtor);
+	}
+	static bool checksum_ok(const void * const prev, arena_detail::dtor_fptr const dtor, size_t const checksum) {
+		return arena_detail::ptr_sec::checksum_ok(prev, dtor, checksum);
+	}
+};
+
+struct none {
+	enum {
+		verify_bounds = 0,
+		verify_checksum = 0
+	};
+
+	static arena_detail::dtor_fptr encode(arena_detail::dtor_fptr const dtor) { return dtor; }
+	static arena_detail::dtor_fptr decode(arena_detail::dtor_fptr const dtor) { return dtor; }
+	static arena_detail::dtor_fptr free_marker() { return &arena_detail::free_marker_dtor; }
+	static arena_detail::dtor_fptr trivial_marker() { return &arena_detail::array_of_primitives_dtor; }
+	static arena_detail::dtor_fptr hole_marker() { return &arena_detail::hole_marker_dtor; }
+
+	static size_t make_checksum(const void * const /*prev*/, arena_detail::dtor_fptr const /*dtor*/) { return 0; }
+	static bool checksum_ok(const void * const /*prev*/, arena_detail::dtor_fptr const /*dtor*/, size_t const /*checksum*/) { return true; }
+};
+
+} //namespace security
+
 /**
  * \class obstack
  * \brief An object stack O(1) memory arena implementation
@@ -195,24 +620,38 @@ private:
  * ^                                            ^             ^       ^
  * mem                                          top_chunk     tos     end_of_mem
  *
+ * An obstack constructed with a block_growth chains additional blocks
+ * from the allocator when the current block is full. The chunk_headers
+ * stay linked across block boundaries and a block is released as soon as
+ * the top of stack is rewound below it.
+ *
+ * The stats policy S is notified about every allocation and deallocation,
+ * see null_stats and counting_stats. The default null_stats compiles to nothing.
+ * The security policy P selects how chunk_headers are protected, see security::hardened.
+ * The hole policy H decides whether memory of objects deallocated out of order
+ * can be reused before the stack shrinks below it, see hole_reuse.
+ * The default no_hole_reuse keeps the pure stack discipline.
+ * Note that objects placed into a hole below a marker are not reclaimed
+ * by rewinding to that marker.
  *
- * TODO support arrays of complex types
  * TODO support array Ts in normal alloc
  *
- * TODO support shared pointers from obstack
- * TODO support explicit obstack nesting
- * TODO C++11 perfect forwarding constructors with refref and variadic templates
- * TODO implement an allocator on top of obstack
- * TODO deal with exceptions in dealloc_all and the destructor
  */
-template<class A>
+template<class A, class S, class P, class H>
 class basic_obstack
-	: private noncopyable
+	: private noncopyable,
+	  private S,
+	  private H
 {
 private:
-	typedef arena_detail::octet_holder<A> holder_type;
+	typedef arena_detail::block_chain<A> holder_type;
 public:
 	typedef A allocator_type;
+	typedef S stats_policy;
+	typedef P security_policy;
+	typedef H hole_policy;
+	///the type of obstacks carved out of this one with make_child
+	typedef basic_obstack<null_allocator<max_align_t>, S, P, H> child_type;
 	typedef typename holder_type::size_type size_type;
 	typedef typename holder_type::byte_type byte_type;
 
@@ -223,6 +662,9 @@ private:
 		chunk_header *prev;
 		dtor_fptr dtor;
 		size_type checksum;
+		///the next chunk below with a non-trivial destructor, fits into the header padding
+		///its low bit is set when the chunk records its start in a prefix, see prev_dtor_of
+		chunk_header *prev_dtor;
 	};
 
 	template<typename T>
@@ -245,6 +687,64 @@ private:
 	struct typed_void {};
 
 public:
+	/**
+	 * \brief a saved top of stack position, see mark() and rewind_to()
+	 */
+	class marker {
+	public:
+		marker() : tos(NULL), top_chunk(NULL), top_dtor_chunk(NULL), size(0) {}
+	private:
+		friend class basic_obstack;
+		marker(byte_type * const tos, chunk_header * const top_chunk, chunk_header * const top_dtor_chunk, size_type const size) :
+			tos(tos),
+			top_chunk(top_chunk),
+			top_dtor_chunk(top_dtor_chunk),
+			size(size)
+		{}
+
+		byte_type *tos;
+		chunk_header *top_chunk;
+		chunk_header *top_dtor_chunk;
+		///the size at the time of marking, tells the marker's block apart from an adjacent one
+		size_type size;
+	};
+
+	/**
+	 * \brief a saved scratch stack position, see mark_scratch() and rewind_scratch()
+	 */
+	class scratch_marker {
+	public:
+		scratch_marker() : end(NULL), top_chunk(NULL) {}
+	private:
+		friend class basic_obstack;
+		scratch_marker(byte_type * const end, chunk_header * const top_chunk) :
+			end(end),
+			top_chunk(top_chunk)
+		{}
+
+		byte_type *end;
+		chunk_header *top_chunk;
+	};
+
+	/**
+	 * \brief rewinds the obstack to the position it had on construction when going out of scope
+	 */
+	class scoped_checkpoint
+		: private noncopyable
+	{
+	public:
+		explicit scoped_checkpoint(basic_obstack &obs) :
+			obs(obs),
+			m(obs.mark())
+		{}
+		~scoped_checkpoint() {
+			obs.rewind_to(m);
+		}
+	private:
+		basic_obstack &obs;
+		marker const m;
+	};
+
 	/**
 	 * \brief construct an obstack of a given capacity on the heap
 	 *
@@ -257,7 +757,29 @@ public:
 	 */
 	explicit basic_obstack(size_type const capacity, const allocator_type &a = allocator_type()) :
 		top_chunk(NULL),
-		memory(capacity, a)
+		top_dtor_chunk(NULL),
+		scratch_top_chunk(NULL),
+		decommit_watermark(no_decommit()),
+		memory(capacity, a, block_growth::none())
+	{
+		BOOST_ASSERT_MSG(capacity, "obstack with capacity of 0 requested");
+		BOOST_ASSERT_MSG(memory.mem(), "global_malloc_allocator returned NULL");
+		tos = memory.mem();
+	}
+
+	/**
+	 * \brief construct a growable obstack with an initial block of a given capacity
+	 *
+	 * When an allocation does not fit into the current block, a new block is
+	 * requested from the allocator as described by growth and chained on top.
+	 * Blocks are released again as soon as all objects in them are deallocated.
+	 */
+	basic_obstack(size_type const capacity, const block_growth &growth, const allocator_type &a = allocator_type()) :
+		top_chunk(NULL),
+		top_dtor_chunk(NULL),
+		scratch_top_chunk(NULL),
+		decommit_watermark(no_decommit()),
+		memory(capacity, a, growth)
 	{
 		BOOST_ASSERT_MSG(capacity, "obstack with capacity of 0 requested");
 		BOOST_ASSERT_MSG(memory.mem(), "global_malloc_allocator returned NULL");
@@ -272,18 +794,31 @@ public:
 	 */
 	basic_obstack(max_align_t *buffer, size_type const buffer_size, const allocator_type &a) :
 		top_chunk(NULL),
+		top_dtor_chunk(NULL),
+		scratch_top_chunk(NULL),
+		decommit_watermark(no_decommit()),
 		memory(
 			buffer && buffer_size ? buffer : NULL,
 			buffer_size,
-			a)
+			a,
+			block_growth::none())
 	{
 		BOOST_ASSERT_MSG(buffer, "supplied buffer is NULL");
 		BOOST_ASSERT_MSG(buffer_size, "supplied buffer_size is 0");
 		tos = memory.mem();
 	}
 
+	/**
+	 * \brief destruct all objects and free the memory
+	 *
+	 * Exceptions thrown by the destructors of objects are swallowed,
+	 * all objects are destructed nonetheless.
+	 */
 	~basic_obstack() {
-		dealloc_all();
+		try {
+			dealloc_all();
+		} catch(...) {
+		}
 	}
 
 	/**
@@ -296,93 +831,301 @@ public:
 	 * Invalid types for T are:
 	 *  - arrays like char[42]
 	 *
-	 * alloc is templated and overloaded for up to 10 arguments.
-	 * These are passed as arguments to the constructor of T.
-	 * For up to 3 arguments, the constructors are perfect forwarding.
-	 * With more than 3 arguments, only const arguments are supported.
+	 * The arguments are passed to the constructor of T.
+	 * With C++11 alloc is a variadic template and perfectly forwards
+	 * any number of arguments, including rvalues, to the constructor.
+	 * When the constructor throws, the allocation is rolled back.
+	 *
+	 * Without variadic templates and rvalue references, alloc is overloaded
+	 * for up to 10 arguments. For up to 3 arguments, the constructors
+	 * are forwarding lvalues. With more than 3 arguments, only const
+	 * arguments are supported.
 	 */
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+	template<typename T, typename... Args>
+	T* alloc(Args&&... args) { return ensure_available<T>() ? push<T>(std::forward<Args>(args)...) : NULL; }
+#else
 	template<typename T>
-	T* alloc() { return mem_available<T>() ? push<T>() : NULL; }
+	T* alloc() { return ensure_available<T>() ? push<T>() : NULL; }
 	template<typename T, typename T1>
-	T* alloc(const T1 &a1) { return mem_available<T>() ? push<T>(a1) : NULL; }
+	T* alloc(const T1 &a1) { return ensure_available<T>() ? push<T>(a1) : NULL; }
 	template<typename T, typename T1>
-	T* alloc(T1 &a1) { return mem_available<T>() ? push<T>(a1) : NULL; }
+	T* alloc(T1 &a1) { return ensure_available<T>() ? push<T>(a1) : NULL; }
 
 	template<typename T, typename T1, typename T2>
-	T* alloc(const T1 &a1, const T2 &a2) { return mem_available<T>() ? push<T>(a1, a2) : NULL; }
+	T* alloc(const T1 &a1, const T2 &a2) { return ensure_available<T>() ? push<T>(a1, a2) : NULL; }
 	template<typename T, typename T1, typename T2>
-	T* alloc(T1 &a1, const T2 &a2) { return mem_available<T>() ? push<T>(a1, a2) : NULL; }
+	T* alloc(T1 &a1, const T2 &a2) { return ensure_available<T>() ? push<T>(a1, a2) : NULL; }
 	template<typename T, typename T1, typename T2>
-	T* alloc(const T1 &a1, T2 &a2) { return mem_available<T>() ? push<T>(a1, a2) : NULL; }
+	T* alloc(const T1 &a1, T2 &a2) { return ensure_available<T>() ? push<T>(a1, a2) : NULL; }
 	template<typename T, typename T1, typename T2>
-	T* alloc(T1 &a1, T2 &a2) { return mem_available<T>() ? push<T>(a1, a2) : NULL; }
+	T* alloc(T1 &a1, T2 &a2) { return ensure_available<T>() ? push<T>(a1, a2) : NULL; }
 
 	template<typename T, typename T1, typename T2, typename T3>
-	T* alloc(const T1 &a1, const T2 &a2, const T3 &a3) { return mem_available<T>() ? push<T>(a1, a2, a3) : NULL; }
+	T* alloc(const T1 &a1, const T2 &a2, const T3 &a3) { return ensure_available<T>() ? push<T>(a1, a2, a3) : NULL; }
 	template<typename T, typename T1, typename T2, typename T3>
-	T* alloc(T1 &a1, const T2 &a2, const T3 &a3) { return mem_available<T>() ? push<T>(a1, a2, a3) : NULL; }
+	T* alloc(T1 &a1, const T2 &a2, const T3 &a3) { return ensure_available<T>() ? push<T>(a1, a2, a3) : NULL; }
 	template<typename T, typename T1, typename T2, typename T3>
-	T* alloc(const T1 &a1, T2 &a2, const T3 &a3) { return mem_available<T>() ? push<T>(a1, a2, a3) : NULL; }
+	T* alloc(const T1 &a1, T2 &a2, const T3 &a3) { return ensure_available<T>() ? push<T>(a1, a2, a3) : NULL; }
 	template<typename T, typename T1, typename T2, typename T3>
-	T* alloc(const T1 &a1, const T2 &a2, T3 &a3) { return mem_available<T>() ? push<T>(a1, a2, a3) : NULL; }
+	T* alloc(const T1 &a1, const T2 &a2, T3 &a3) { return ensure_available<T>() ? push<T>(a1, a2, a3) : NULL; }
 	template<typename T, typename T1, typename T2, typename T3>
-	T* alloc(const T1 &a1, T2 &a2, T3 &a3) { return mem_available<T>() ? push<T>(a1, a2, a3) : NULL; }
+	T* alloc(const T1 &a1, T2 &a2, T3 &a3) { return ensure_available<T>() ? push<T>(a1, a2, a3) : NULL; }
 	template<typename T, typename T1, typename T2, typename T3>
-	T* alloc(T1 &a1, const T2 &a2, T3 &a3) { return mem_available<T>() ? push<T>(a1, a2, a3) : NULL; }
+	T* alloc(T1 &a1, const T2 &a2, T3 &a3) { return ensure_available<T>() ? push<T>(a1, a2, a3) : NULL; }
 	template<typename T, typename T1, typename T2, typename T3>
-	T* alloc(T1 &a1, T2 &a2, const T3 &a3) { return mem_available<T>() ? push<T>(a1, a2, a3) : NULL; }
+	T* alloc(T1 &a1, T2 &a2, const T3 &a3) { return ensure_available<T>() ? push<T>(a1, a2, a3) : NULL; }
 	template<typename T, typename T1, typename T2, typename T3>
-	T* alloc(T1 &a1, T2 &a2, T3 &a3) { return mem_available<T>() ? push<T>(a1, a2, a3) : NULL; }
+	T* alloc(T1 &a1, T2 &a2, T3 &a3) { return ensure_available<T>() ? push<T>(a1, a2, a3) : NULL; }
 
 	//with more then 3 arguments, binomial explosion really sets in, so we can just support const
 	
 	template<typename T, typename T1, typename T2, typename T3, typename T4>
 	T* alloc(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4) {
-		return mem_available<T>() ? push<T>(a1, a2, a3, a4) : NULL;
+		return ensure_available<T>() ? push<T>(a1, a2, a3, a4) : NULL;
 	}
 	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5>
 	T* alloc(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5) {
-		return mem_available<T>() ? push<T>(a1, a2, a3, a4, a5) : NULL;
+		return ensure_available<T>() ? push<T>(a1, a2, a3, a4, a5) : NULL;
 	}
 	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
 	T* alloc(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6) {
-		return mem_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6) : NULL;
+		return ensure_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6) : NULL;
 	}
 	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
 	T* alloc(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6, const T7 &a7) {
-		return mem_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6, a7) : NULL;
+		return ensure_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6, a7) : NULL;
 	}
 	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
 	T* alloc(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6, const T7 &a7, const T8 &a8) {
-		return mem_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6, a7, a8) : NULL;
+		return ensure_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6, a7, a8) : NULL;
 	}
 	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8, typename T9>
 	T* alloc(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6, const T7 &a7, const T8 &a8, const T9 &a9) {
-		return mem_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6, a7, a8, a9) : NULL;
+		return ensure_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6, a7, a8, a9) : NULL;
 	}
 	template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8, typename T9, typename T10>
 	T* alloc(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6, const T7 &a7, const T8 &a8, const T9 &a9, const T10 &a10) {
-		return mem_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10) : NULL;
+		return ensure_available<T>() ? push<T>(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10) : NULL;
 	}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
 
 
 	/**
 	 * \brief Allocate a linear packed array of elements.
 	 *
-	 * T must be a POD type since there is no cunstructor called.
+	 * For POD types there is no cunstructor called, the elements are uninitialized.
+	 * Other types are default constructed, or constructed from the given arguments
+	 * (all elements from the same arguments), in ascending order.
+	 * When a constructor throws, the already constructed elements are destructed
+	 * in reverse order, the array is taken back and the exception is rethrown.
+	 *
+	 * The whole array gets a single chunk_header. Types with a non-trivial
+	 * destructor also store the number of elements in front of the header:
+	 * dealloc destructs all elements in reverse order with a single dtor call.
 	 * There will be no padding between the elements of the array.
 	 */
 	template<typename T>
 	T* alloc_array(size_type num_elements) {
-		BOOST_STATIC_ASSERT_MSG( is_pod<T>::value, "T must be a POD type.");
+		return is_pod<T>::value ?
+			alloc_storage<T>(num_elements) :
+			construct_array<T>(num_elements, value_initializer<T>());
+	}
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+	template<typename T, typename... Args>
+	T* alloc_array(size_type num_elements, const Args&... args) {
+		return construct_array<T>(num_elements, [&](void * const p) { new(p) T(args...); });
+	}
+#else
+	template<typename T, typename T1>
+	T* alloc_array(size_type num_elements, const T1 &a1) {
+		return construct_array<T>(num_elements, copy_initializer<T, T1>(a1));
+	}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+
+	/**
+	 * \brief Allocate a batch of num_objects value-initialized objects with one chunk_header
+	 *
+	 * Unlike alloc_array, also POD types are value-initialized.
+	 * The capacity check, the alignment and the header are done once for the
+	 * whole batch and the objects are contiguous. The batch is deallocated
+	 * as a whole by passing the returned pointer to dealloc.
+	 */
+	template<typename T>
+	T* alloc_n(size_type const num_objects) {
+		return construct_array<T>(num_objects, value_initializer<T>());
+	}
+
+	/**
+	 * \brief Allocate a batch like alloc_n and write a pointer to each object to out
+	 *
+	 * Returns a pointer to the first object. When the obstack is full,
+	 * NULL is returned and nothing is written to out.
+	 */
+	template<typename T, typename OutputIterator>
+	T* alloc_batch(size_type const num_objects, OutputIterator out) {
+		T * const batch = alloc_n<T>(num_objects);
+		if(batch) {
+			for(size_type i=0; i<num_objects; i++) {
+				*out = batch + i;
+				++out;
+			}
+		}
+		return batch;
+	}
+
+	/**
+	 * \brief Allocate a T aligned to align, which may exceed alignment_of<T> and max_align_t
+	 *
+	 * For cache-line aligned data that must not be falsely shared, and for
+	 * SIMD vectors that are used with aligned loads. The padding in front of
+	 * the chunk_header is taken from the obstack, the memory blocks themselves
+	 * only need to be max_align_t aligned. alignment_request::cache_line()
+	 * also pads the tail, so the object has its cache lines to itself.
+	 * The object is deallocated with dealloc like any other.
+	 */
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+	template<typename T, typename... Args>
+	T* alloc_aligned(const alignment_request &align, Args&&... args) {
+		return construct_aligned<T>(align, [&](void * const p) { new(p) T(std::forward<Args>(args)...); });
+	}
+#else
+	template<typename T>
+	T* alloc_aligned(const alignment_request &align) {
+		return construct_aligned<T>(align, value_initializer<T>());
+	}
+	template<typename T, typename T1>
+	T* alloc_aligned(const alignment_request &align, const T1 &a1) {
+		return construct_aligned<T>(align, copy_initializer<T, T1>(a1));
+	}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+
+	/**
+	 * \brief Allocate a linear packed array like alloc_array, with its first element aligned to align
+	 *
+	 * Only the first element is over-aligned, the elements stay packed.
+	 * For POD types the elements are uninitialized.
+	 */
+	template<typename T>
+	T* alloc_array_aligned(size_type const num_elements, const alignment_request &align) {
+		const size_type align_to = aligned_to<T>(align);
+		const size_type array_bytes = aligned_bytes(align, align_to, sizeof(T)*num_elements);
+		return is_pod<T>::value ?
+			construct_array<T>(num_elements, no_initializer(), align_to, array_bytes) :
+			construct_array<T>(num_elements, value_initializer<T>(), align_to, array_bytes);
+	}
+
+	/**
+	 * \brief Allocate uninitialized storage for a linear packed array of elements.
+	 *
+	 * Unlike alloc_array, T may be any type. No constructors are called and
+	 * dealloc will not call any destructors, the caller is responsible for the
+	 * lifetime of the elements. This is the storage an allocator hands out.
+	 */
+	template<typename T>
+	T* alloc_storage(size_type num_elements) {
 		const size_type array_bytes = sizeof(T)*num_elements;
-		const size_type align_to = alignment<T>::value; 
-		if( mem_available<T>(num_elements) ) {
-			allocate(align_to, array_bytes, arena_detail::array_of_primitives_dtor_xor);
-			return reinterpret_cast<T*>(top_object());
-		} else {
+		if(hole_policy::enabled) {
+			byte_type * const hole = take_hole(alignment_of<T>::value, array_bytes);
+			if(hole) {
+				return reinterpret_cast<T*>(hole);
+			}
+		}
+		return alloc_storage_on_top<T>(num_elements);
+	}
+
+	/**
+	 * \brief carve a child obstack with capacity bytes out of this obstack
+	 *
+	 * The child object and its memory are placed in a single chunk,
+	 * there is no further allocation. The child works on its own and can be
+	 * handed to another thread, it never grows beyond its capacity.
+	 * Deallocating the child (or rewinding or destructing the parent)
+	 * destructs all objects in the child and reclaims its memory.
+	 *
+	 * complexity: O(1)
+	 */
+	child_type* make_child(size_type const capacity) {
+		const size_type align_to = alignment<max_align_t>::value;
+		const size_type head = max_aligned_sizeof<child_type>::value;
+		const size_type child_capacity = holder_type::holder_type::to_alloc_capacity(capacity) * sizeof(max_align_t);
+		if(!mem_available(align_to, 0, head + child_capacity) && !grow(align_to, head + child_capacity)) {
 			return NULL;
 		}
+		allocate(align_to, head + child_capacity, encode_dtor(&arena_detail::call_dtor<child_type>));
+		byte_type * const obj = top_object();
+		max_align_t * const buffer = reinterpret_cast<max_align_t*>(obj + head);
+		return new(obj) child_type(buffer, child_capacity, null_allocator<max_align_t>());
+	}
+
+	/**
+	 * \brief resize the array on the top of the obstack in place
+	 *
+	 * Returns true when array is the top of stack and the new size fits into
+	 * the current block. Otherwise nothing is changed and false is returned.
+	 *
+	 * complexity: O(1)
+	 */
+	template<typename T>
+	bool try_extend(T * const array, size_type const new_num_elements) {
+		BOOST_STATIC_ASSERT_MSG( is_pod<T>::value, "T must be a POD type.");
+		if(!array || !is_top(array)) {
+			return false;
+		}
+		byte_type * const new_tos = reinterpret_cast<byte_type*>(array + new_num_elements);
+		if(new_tos > memory.end_of_mem()) {
+			return false;
+		}
+		const size_type old_bytes = static_cast<size_type>(tos - reinterpret_cast<byte_type*>(array));
+		tos = new_tos;
+		stats_hooks().on_resize(array, old_bytes, sizeof(T)*new_num_elements, size());
+		return true;
+	}
+
+	/**
+	 * \brief grow the array on the top of the obstack to new_num_elements
+	 *
+	 * The array grows in place when there is enough memory in the current block.
+	 * Otherwise it is moved into a newly chained block (if the obstack is growable)
+	 * and the old copy is deallocated.
+	 * Returns a pointer to the grown array or NULL if array is not the
+	 * top of stack or there is not enough memory, the array stays untouched in that case.
+	 *
+	 * complexity: O(1) when growing in place, O(n) when the array is moved
+	 */
+	template<typename T>
+	T* grow_top(T * const array, size_type const new_num_elements) {
+		if(try_extend(array, new_num_elements)) {
+			return array;
+		}
+		if(!array || !is_top(array)) {
+			return NULL;
+		}
+
+		const size_type old_bytes = static_cast<size_type>(tos - reinterpret_cast<byte_type*>(array));
+		//a hole would not be the top of stack, so it could not grow any further
+		T * const new_array = alloc_storage_on_top<T>(new_num_elements);
+		if(new_array) {
+			std::memcpy(new_array, array, std::min(old_bytes, sizeof(T)*new_num_elements));
+			dealloc(array);
+		}
+		return new_array;
+	}
+
+	/**
+	 * \brief shrink the array on the top of the obstack to new_num_elements and reclaim the memory behind it
+	 *
+	 * When array is not the top of stack, nothing happens.
+	 *
+	 * complexity: O(1)
+	 */
+	template<typename T>
+	void shrink_top(T * const array, size_type const new_num_elements) {
+		BOOST_ASSERT_MSG(
+			!is_top(array) || reinterpret_cast<byte_type*>(array + new_num_elements) <= tos,
+			"shrink_top would grow the array"
+		);
+		try_extend(array, new_num_elements);
 	}
 
 	/**
@@ -399,7 +1142,9 @@ public:
 	void dealloc(void * const obj) {
 		if(obj) {
 			typed_void * const typed_obj = to_typed_void(obj);
-			if(is_top(typed_obj)) {
+			const bool on_top = is_top(typed_obj);
+			stats_hooks().on_dealloc(obj, on_top);
+			if(on_top) {
 				pop(typed_obj);
 			} else {
 				destruct(typed_obj);
@@ -408,12 +1153,159 @@ public:
 	}
 
 	/**
-	 * \brief destruct and reclaim memory of all objects on the obstack
+	 * \brief destruct an object of size bytes on the obstack and reclaim memory if possible
+	 *
+	 * The chunk header knows the extent of the object, this overload exists
+	 * for interface compatibility with bump_obstack.
+	 * With the hole_reuse policy, an object deallocated out of order is
+	 * recorded as a hole of size bytes that later allocations can reuse.
+	 */
+	void dealloc(void * const obj, size_type const size) {
+		if(hole_policy::enabled && obj && !is_top(obj)) {
+			typed_void * const typed_obj = to_typed_void(obj);
+			stats_hooks().on_dealloc(obj, false);
+			destruct(typed_obj);
+			if(size >= hole_policy::min_hole_size()) {
+				record_hole(to_chunk_header(typed_obj), size);
+			}
+		} else {
+			dealloc(obj);
+		}
+	}
+
+	/**
+	 * \brief destruct and reclaim memory of all objects on the obstack, scratch objects included
+	 *
+	 * When a destructor throws, the remaining objects are still destructed,
+	 * the obstack is emptied and then the first exception is rethrown.
+	 * Objects of trivially destructible types are not on the destructor list:
+	 * if there are only such objects, nothing is walked at all.
+	 *
+	 * complexity: O(k) where k is the number of objects with non-trivial destructors,
+	 * O(1) when there are none (plus O(b) for b chained blocks)
 	 */
 	void dealloc_all() {
-		while(top_chunk) {
-			pop(top_chunk);
+		byte_type * const old_tos = tos;
+		if(scratch_top_chunk) {
+			try {
+				dealloc_all_scratch();
+			} catch(...) {
+				destruct_above_nothrow(NULL);
+				reset();
+				throw;
+			}
 		}
+		if(top_dtor_chunk) {
+			try {
+				destruct_above(NULL);
+			} catch(...) {
+				destruct_above_nothrow(NULL);
+				reset();
+				throw;
+			}
+		}
+		reset();
+		decommit_after_rewind(old_tos);
+	}
+
+	///save the current top of stack
+	marker mark() const { return marker(tos, top_chunk, top_dtor_chunk, size()); }
+
+	/**
+	 * \brief Allocate an object on the scratch stack, which grows down from the end of the memory block
+	 *
+	 * The obstack becomes double-ended: results are allocated with alloc as
+	 * usual while transient data goes to the scratch stack from the other end,
+	 * and both share the free memory between them. Scratch objects are freed
+	 * wholesale with rewind_scratch or dealloc_all_scratch, never with dealloc,
+	 * so they do not block the objects on the main stack and vice versa.
+	 *
+	 * The scratch stack needs one contiguous block: it is only available while
+	 * the obstack has not chained additional blocks, and the obstack does not
+	 * grow while there are scratch objects. Scratch allocations are not
+	 * reported to the stats policy and do not reuse holes.
+	 */
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+	template<typename T, typename... Args>
+	T* alloc_scratch(Args&&... args) {
+		return construct_scratch<T>(1, [&](void * const p) { new(p) T(std::forward<Args>(args)...); }, false);
+	}
+#else
+	template<typename T>
+	T* alloc_scratch() {
+		return construct_scratch<T>(1, value_initializer<T>(), false);
+	}
+	template<typename T, typename T1>
+	T* alloc_scratch(const T1 &a1) {
+		return construct_scratch<T>(1, copy_initializer<T, T1>(a1), false);
+	}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+
+	///Allocate a linear packed array on the scratch stack like alloc_array, PODs are uninitialized
+	template<typename T>
+	T* alloc_scratch_array(size_type const num_elements) {
+		return is_pod<T>::value ?
+			construct_scratch<T>(num_elements, no_initializer(), true) :
+			construct_scratch<T>(num_elements, value_initializer<T>(), true);
+	}
+
+	///save the current bottom of the scratch stack
+	scratch_marker mark_scratch() const { return scratch_marker(memory.end_of_mem(), scratch_top_chunk); }
+
+	/**
+	 * \brief destruct and reclaim all scratch objects allocated after the marker has been taken
+	 *
+	 * The main stack is not touched. When a destructor throws, the scratch
+	 * stack is still rewound completely and then the first exception is rethrown.
+	 *
+	 * complexity: O(n) where n is the number of scratch objects above the marker
+	 */
+	void rewind_scratch(const scratch_marker &m) {
+		BOOST_ASSERT_MSG(m.end, "rewind to an empty marker");
+		BOOST_ASSERT_MSG(m.end >= memory.end_of_mem(), "rewind to an invalid marker");
+		try {
+			destruct_scratch_above(m.top_chunk);
+		} catch(...) {
+			destruct_scratch_above_nothrow(m.top_chunk);
+			memory.set_end_of_mem(m.end);
+			throw;
+		}
+		memory.set_end_of_mem(m.end);
+	}
+
+	///destruct and reclaim all scratch objects
+	void dealloc_all_scratch() {
+		rewind_scratch(scratch_marker(memory.end_of_block(), NULL));
+	}
+
+	///get the number of bytes taken by the scratch stack
+	size_type scratch_size() const { return static_cast<size_type>(memory.end_of_block() - memory.end_of_mem()); }
+
+	/**
+	 * \brief destruct and reclaim memory of all objects allocated after the marker has been taken
+	 *
+	 * Objects with trivial destructors and objects that are already destructed are skipped,
+	 * without touching their memory.
+	 * A marker becomes invalid when an object allocated before the marker
+	 * is deallocated from the top of the obstack.
+	 * When a destructor throws, the obstack is still rewound completely
+	 * and then the first exception is rethrown.
+	 *
+	 * complexity: O(k) where k is the number of objects with non-trivial destructors above the marker
+	 */
+	void rewind_to(const marker &m) {
+		BOOST_ASSERT_MSG(m.tos, "rewind to an empty marker");
+		BOOST_ASSERT_MSG(!is_in_current_block(m.tos) || m.tos <= tos, "rewind to an invalid marker");
+		byte_type * const old_tos = tos;
+		try {
+			destruct_above(m.top_dtor_chunk);
+		} catch(...) {
+			destruct_above_nothrow(m.top_dtor_chunk);
+			reset_to(m);
+			throw;
+		}
+		reset_to(m);
+		decommit_after_rewind(old_tos);
 	}
 
 	/**
@@ -428,7 +1320,7 @@ public:
 	 * \brief check if a given pointer is inside this arena and is a valid pointer to an object.
 	 */
 	bool is_valid(const void * const obj) const {
-		return is_valid(to_chunk_header(obj));
+		return is_valid(to_chunk_header(to_typed_void(obj)));
 	}
 
 	/**
@@ -438,15 +1330,64 @@ public:
 	 */
 	static size_type max_overhead(const size_type num_elements) {
 		const size_type max_alignment = alignment<max_align_t>::value;
-		return (max_aligned_sizeof<chunk_header>::value+max_alignment)*num_elements;
+		return (max_aligned_sizeof<chunk_header>::value+counted_prefix+max_alignment)*num_elements;
 	}
 
 	///get the number of bytes that are already allocated
-	size_type size() const { return static_cast<size_type>(tos-memory.mem()); }
+	size_type size() const { return memory.used_below() + static_cast<size_type>(tos-memory.mem()); }
 	///get the number of bytes that are available in the obstack in total
 	size_type capacity() const { return memory.capacity(); }
 
+	///give cached but unused memory blocks back to the allocator
+	void trim() { memory.trim(); }
+
+	/**
+	 * \brief give the pages above the top of stack back to the operating system
+	 *
+	 * The first keep bytes above the top of stack stay resident for the next
+	 * allocations. Memory mapped by mmap_allocator (or large heap blocks) is
+	 * committed by the operating system on first touch, so with this a large
+	 * arena only occupies the pages that are in use. A scratch stack is not touched.
+	 * Returns the number of bytes released.
+	 */
+	size_type decommit(size_type const keep = 0) {
+		const size_type available = static_cast<size_type>(memory.end_of_mem() - tos);
+		return keep < available ? arena_detail::decommit_pages(tos + keep, memory.end_of_mem()) : 0;
+	}
+
+	/**
+	 * \brief decommit automatically when the stack shrinks by more than watermark bytes
+	 *
+	 * dealloc_all and rewind_to then release the pages that were in use
+	 * above the new top of stack plus watermark. Popping single objects never decommits.
+	 * no_decommit() turns this off again, which is the default.
+	 */
+	void set_decommit_watermark(size_type const watermark) { decommit_watermark = watermark; }
+	size_type get_decommit_watermark() const { return decommit_watermark; }
+	static size_type no_decommit() { return std::numeric_limits<size_type>::max(); }
+
+	/**
+	 * \brief take a snapshot of the allocation statistics
+	 *
+	 * size and capacity are always filled in, everything else
+	 * only when the stats policy counts it.
+	 */
+	obstack_stats stats() const {
+		obstack_stats s;
+		s.size = size();
+		s.capacity = capacity();
+		static_cast<const stats_policy&>(*this).fill(s);
+		return s;
+	}
+
+	///access the stats policy, e.g. to read the events recorded by trace_stats
+	const stats_policy& get_stats_policy() const { return *this; }
+
 private:
+	stats_policy& stats_hooks() { return *this; }
+	hole_policy& holes() { return *this; }
+	const hole_policy& holes() const { return *this; }
+
 	static typed_void * to_typed_void(void *obj) {
 		return reinterpret_cast<typed_void*>(obj);
 	}
@@ -454,16 +1395,15 @@ private:
 		return reinterpret_cast<const typed_void*>(obj);
 	}
 	
-	static dtor_fptr xor_fptr(dtor_fptr const fptr) {
-		return arena_detail::ptr_sec::xor_ptr(fptr);
+	static dtor_fptr encode_dtor(dtor_fptr const fptr) {
+		return security_policy::encode(fptr);
 	}
 
 	/**
 	 * \brief calculate the required padding bytes to the next fully aligned pointer
 	 */
 	static size_type offset_to_alignment(const void * const p, const size_type align_to) {
-		const size_type address = reinterpret_cast<size_type>(p);
-		return address % align_to ? (align_to - address%align_to): 0;
+		return arena_detail::offset_to_alignment(p, align_to);
 	}
 
   template<typename T>
@@ -478,101 +1418,508 @@ private:
 		return tos + padding + max_aligned_sizeof<chunk_header>::value + sizeof(T)*num_elements < memory.end_of_mem();
 	}
 
+	bool mem_available(const size_type align_to, const size_type prefix, const size_type size) const {
+		const size_type padding = offset_to_alignment(tos + prefix + max_aligned_sizeof<chunk_header>::value, align_to);
+		return tos + prefix + padding + max_aligned_sizeof<chunk_header>::value + size < memory.end_of_mem();
+	}
+
+	template<typename T>
+	bool ensure_available() {
+		return BOOST_LIKELY(mem_available<T>()) || hole_available<T>() || grow(alignment<T>::value, sizeof(T));
+	}
+	///whether allocate<T> will place a T into a hole
+	template<typename T>
+	bool hole_available() const {
+		return
+			hole_policy::enabled &&
+			has_trivial_destructor<T>::value &&
+			holes().can_take(sizeof(T), alignment_of<T>::value);
+	}
+	template<typename T>
+	bool ensure_available(const size_type num_elements) {
+		return BOOST_LIKELY(mem_available<T>(num_elements)) || grow(alignment<T>::value, sizeof(T)*num_elements);
+	}
+
+	/**
+	 * \brief chain a new block that can hold a chunk of size bytes aligned to align_to
+	 *
+	 * A scratch stack is bound to its block, so there is no growth while it holds objects.
+	 */
+	BOOST_NOINLINE bool grow(size_type const align_to, size_type const size) {
+		if(scratch_top_chunk) {
+			return false;
+		}
+		const size_type required = align_to + max_aligned_sizeof<chunk_header>::value + size + 1;
+		if(memory.push_block(tos, required)) {
+			tos = memory.mem();
+			return true;
+		} else {
+			return false;
+		}
+	}
+
 	byte_type* top_object() const {
 		return reinterpret_cast<byte_type*>(top_chunk) + max_aligned_sizeof<chunk_header>::value;
 	}
 
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+	template<typename T, typename... Args>
+	T* push(Args&&... args) {
+		byte_type * const obj = allocate<T>();
+		try {
+			return new(obj) T(std::forward<Args>(args)...);
+		} catch(...) {
+			unallocate(to_typed_void(obj), sizeof(T));
+			throw;
+		}
+	}
+#else
 	template<typename T>
-	T* push() { allocate<T>(); return new(top_object()) T(); }
+	T* push() { return new(allocate<T>()) T(); }
 	template<typename T, typename T1>
-	T* push(const T1 &a1) { allocate<T>(); return new(top_object()) T(a1); }
+	T* push(const T1 &a1) { return new(allocate<T>()) T(a1); }
   template<typename T, typename T1>
-	T* push(T1 &a1) { allocate<T>(); return new(top_object()) T(a1); }
+	T* push(T1 &a1) { return new(allocate<T>()) T(a1); }
 
   template<typename T, typename T1, typename T2>
-	T* push(const T1 &a1, const T2 &a2) { allocate<T>(); return new(top_object()) T(a1, a2); }
+	T* push(const T1 &a1, const T2 &a2) { return new(allocate<T>()) T(a1, a2); }
   template<typename T, typename T1, typename T2>
-	T* push(T1 &a1, const T2 &a2) { allocate<T>(); return new(top_object()) T(a1, a2); }
+	T* push(T1 &a1, const T2 &a2) { return new(allocate<T>()) T(a1, a2); }
   template<typename T, typename T1, typename T2>
-	T* push(const T1 &a1, T2 &a2) { allocate<T>(); return new(top_object()) T(a1, a2); }
+	T* push(const T1 &a1, T2 &a2) { return new(allocate<T>()) T(a1, a2); }
   template<typename T, typename T1, typename T2>
-	T* push(T1 &a1, T2 &a2) { allocate<T>(); return new(top_object()) T(a1, a2); }
+	T* push(T1 &a1, T2 &a2) { return new(allocate<T>()) T(a1, a2); }
 
   template<typename T, typename T1, typename T2, typename T3>
-	T* push(const T1 &a1, const T2 &a2, const T3 &a3) { allocate<T>(); return new(top_object()) T(a1, a2, a3); }
+	T* push(const T1 &a1, const T2 &a2, const T3 &a3) { return new(allocate<T>()) T(a1, a2, a3); }
   template<typename T, typename T1, typename T2, typename T3>
-	T* push(T1 &a1, const T2 &a2, const T3 &a3) { allocate<T>(); return new(top_object()) T(a1, a2, a3); }
+	T* push(T1 &a1, const T2 &a2, const T3 &a3) { return new(allocate<T>()) T(a1, a2, a3); }
   template<typename T, typename T1, typename T2, typename T3>
-	T* push(const T1 &a1, T2 &a2, const T3 &a3) { allocate<T>(); return new(top_object()) T(a1, a2, a3); }
+	T* push(const T1 &a1, T2 &a2, const T3 &a3) { return new(allocate<T>()) T(a1, a2, a3); }
   template<typename T, typename T1, typename T2, typename T3>
-	T* push(const T1 &a1, const T2 &a2, T3 &a3) { allocate<T>(); return new(top_object()) T(a1, a2, a3); }
+	T* push(const T1 &a1, const T2 &a2, T3 &a3) { return new(allocate<T>()) T(a1, a2, a3); }
   template<typename T, typename T1, typename T2, typename T3>
-	T* push(const T1 &a1, T2 &a2, T3 &a3) { allocate<T>(); return new(top_object()) T(a1, a2, a3); }
+	T* push(const T1 &a1, T2 &a2, T3 &a3) { return new(allocate<T>()) T(a1, a2, a3); }
   template<typename T, typename T1, typename T2, typename T3>
-	T* push(T1 &a1, const T2 &a2, T3 &a3) { allocate<T>(); return new(top_object()) T(a1, a2, a3); }
+	T* push(T1 &a1, const T2 &a2, T3 &a3) { return new(allocate<T>()) T(a1, a2, a3); }
   template<typename T, typename T1, typename T2, typename T3>
-	T* push(T1 &a1, T2 &a2, const T3 &a3) { allocate<T>(); return new(top_object()) T(a1, a2, a3); }
+	T* push(T1 &a1, T2 &a2, const T3 &a3) { return new(allocate<T>()) T(a1, a2, a3); }
   template<typename T, typename T1, typename T2, typename T3>
-	T* push(T1 &a1, T2 &a2, T3 &a3) { allocate<T>(); return new(top_object()) T(a1, a2, a3); }
+	T* push(T1 &a1, T2 &a2, T3 &a3) { return new(allocate<T>()) T(a1, a2, a3); }
 
 
   template<typename T, typename T1, typename T2, typename T3, typename T4>
 	T* push(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4) {
-		allocate<T>();
-		return new(top_object()) T(a1, a2, a3, a4);
+		return new(allocate<T>()) T(a1, a2, a3, a4);
 	}
   template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5>
 	T* push(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5) {
-		allocate<T>();
-		return new(top_object()) T(a1, a2, a3, a4, a5);
+		return new(allocate<T>()) T(a1, a2, a3, a4, a5);
 	}
   template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
 	T* push(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6) {
-		allocate<T>();
-		return new(top_object()) T(a1, a2, a3, a4, a5, a6);
+		return new(allocate<T>()) T(a1, a2, a3, a4, a5, a6);
 	}
   template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
 	T* push(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6, const T7 &a7) {
-		allocate<T>();
-		return new(top_object()) T(a1, a2, a3, a4, a5, a6, a7);
+		return new(allocate<T>()) T(a1, a2, a3, a4, a5, a6, a7);
 	}
   template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
 	T* push(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6, const T7 &a7, const T8 &a8) {
-		allocate<T>();
-		return new(top_object()) T(a1, a2, a3, a4, a5, a6, a7, a8);
+		return new(allocate<T>()) T(a1, a2, a3, a4, a5, a6, a7, a8);
 	}
   template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8, typename T9>
 	T* push(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6, const T7 &a7, const T8 &a8, const T9 &a9) {
-		allocate<T>();
-		return new(top_object()) T(a1, a2, a3, a4, a5, a6, a7, a8, a9);
+		return new(allocate<T>()) T(a1, a2, a3, a4, a5, a6, a7, a8, a9);
 	}
   template<typename T, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8, typename T9, typename T10>
 	T* push(const T1 &a1, const T2 &a2, const T3 &a3, const T4 &a4, const T5 &a5, const T6 &a6, const T7 &a7, const T8 &a8, const T9 &a9, const T10 &a10) {
-		allocate<T>();
-		return new(top_object()) T(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10);
+		return new(allocate<T>()) T(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10);
 	}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
  
 	bool is_valid(const chunk_header * const chead) const {
-		bool const is_inside_arena =
-			reinterpret_cast<const byte_type*>(chead) >= memory.mem() &&
-			reinterpret_cast<const byte_type*>(chead) <= memory.end_of_mem();
-		return is_inside_arena && arena_detail::ptr_sec::checksum_ok(chead->prev, chead->dtor, chead->checksum);
+		bool const is_inside_arena = memory.contains(chead);
+		return is_inside_arena && security_policy::checksum_ok(chead->prev, chead->dtor, chead->checksum);
 	}
 
-	void allocate(size_type const align_to, size_type const size, dtor_fptr const xored_dtor) {
-		tos += offset_to_alignment(tos, align_to);
+	/**
+	 * \brief place a chunk_header and reserve size bytes behind it
+	 *
+	 * The object behind the chunk_header is aligned to align_to. As the header
+	 * size is a multiple of max_align_t, the header itself is aligned as well.
+	 * prefix bytes are reserved in front of the chunk_header, e.g. for an array count.
+	 * A chunk with a prefix records where it starts in the first prefix word,
+	 * so that reclaiming it gives back the prefix and the padding as well.
+	 */
+	void allocate(size_type const align_to, size_type const size, dtor_fptr const encoded_dtor, size_type const prefix = 0) {
+		BOOST_ASSERT_MSG(!prefix || prefix >= counted_prefix, "a chunk prefix must hold the chunk start");
+		byte_type * const chunk_begin = tos;
+		tos += prefix;
+		const size_type padding = offset_to_alignment(tos + max_aligned_sizeof<chunk_header>::value, align_to);
+		tos += padding;
 		chunk_header * const chead = reinterpret_cast<chunk_header*>(tos);
 		chead->prev = top_chunk;
-		chead->dtor = xored_dtor;
-		chead->checksum = arena_detail::ptr_sec::make_checksum(chead->prev, chead->dtor);
+		chead->dtor = encoded_dtor;
+		chead->checksum = security_policy::make_checksum(chead->prev, chead->dtor);
+		chead->prev_dtor = top_dtor_chunk;
+		if(prefix) {
+			chunk_offset(chead) = static_cast<size_type>(tos - chunk_begin);
+			chead->prev_dtor = reinterpret_cast<chunk_header*>(reinterpret_cast<size_type>(top_dtor_chunk) | has_chunk_offset);
+		}
 		top_chunk = chead;
+		if(encoded_dtor != security_policy::trivial_marker()) {
+			top_dtor_chunk = chead;
+		}
 		// allocate memory
 		tos += max_aligned_sizeof<chunk_header>::value + size;
+		stats_hooks().on_allocate(top_object(), align_to, padding, prefix + max_aligned_sizeof<chunk_header>::value, size, this->size());
+	}
+
+	///place a T on the top of stack or, for trivially destructible types, into a hole
+	template<typename T>
+	byte_type* allocate() {
+		if(hole_policy::enabled && has_trivial_destructor<T>::value) {
+			byte_type * const hole = take_hole(alignment_of<T>::value, sizeof(T));
+			if(hole) {
+				return hole;
+			}
+		}
+		allocate(alignment<T>::value, sizeof(T), encoded_dtor_of<T>());
+		return top_object();
+	}
+
+	/**
+	 * \brief take back the top chunk without calling its destructor, used when a constructor failed
+	 */
+	void unallocate_top() {
+		chunk_header * const chead = top_chunk;
+		if(chead == top_dtor_chunk) {
+			top_dtor_chunk = prev_dtor_of(chead);
+		}
+		top_chunk = chead->prev;
+		tos = begin_of_chunk(chead);
+		stats_hooks().on_unallocate(to_object(chead));
+		release_empty_blocks();
+	}
+
+	/**
+	 * \brief take back a chunk of size bytes without calling its destructor, used when a constructor failed
+	 *
+	 * A chunk that was placed into a hole is recorded as a hole of size bytes again.
+	 */
+	void unallocate(typed_void * const obj, size_type const size) {
+		chunk_header * const chead = to_chunk_header(obj);
+		if(chead == top_chunk) {
+			unallocate_top();
+		} else {
+			chead->dtor = security_policy::free_marker();
+			stats_hooks().on_destruct();
+			if(hole_policy::enabled && size >= hole_policy::min_hole_size()) {
+				record_hole(chead, size);
+			}
+		}
+	}
+
+	///turn the destructed chunk chead into a hole of size bytes
+	void record_hole(chunk_header * const chead, size_type const size) {
+		chead->dtor = security_policy::hole_marker();
+		holes().record(to_object(chead), size);
+	}
+
+	///remove chead from the holes when it is one, because its memory is reclaimed
+	void forget_hole(chunk_header * const chead) {
+		if(hole_policy::enabled && chead->dtor == security_policy::hole_marker()) {
+			holes().unlink(to_object(chead));
+		}
+	}
+
+	/**
+	 * \brief turn a hole of at least size bytes into a live chunk of a trivially destructible object
+	 *
+	 * The chunk stays where it is in the chunk chain, only its
+	 * destructor and checksum are renewed. Returns NULL if no hole fits.
+	 *
+	 * complexity: O(1)
+	 */
+	byte_type* take_hole(size_type const align_to, size_type const size) {
+		void * const obj = holes().take(size, align_to);
+		if(!obj) {
+			return NULL;
+		}
+		chunk_header * const chead = to_chunk_header(to_typed_void(obj));
+		chead->dtor = security_policy::trivial_marker();
+		chead->checksum = security_policy::make_checksum(chead->prev, chead->dtor);
+		stats_hooks().on_reuse(obj, align_to, size);
+		return static_cast<byte_type*>(obj);
+	}
+
+	///whether chead is destructed, a hole is destructed as well
+	static bool is_free(const chunk_header * const chead) {
+		return
+			chead->dtor == security_policy::free_marker() ||
+			(hole_policy::enabled && chead->dtor == security_policy::hole_marker());
+	}
+
+	///trivially destructible objects are recorded like arrays of primitives and never destructed
+	template<typename T>
+	static dtor_fptr encoded_dtor_of() {
+		return has_trivial_destructor<T>::value ?
+			security_policy::trivial_marker() :
+			encode_dtor(&arena_detail::call_dtor<T>);
+	}
+
+	///uninitialized storage like alloc_storage, always on the top of stack and never in a hole
+	template<typename T>
+	T* alloc_storage_on_top(size_type const num_elements) {
+		if( ensure_available<T>(num_elements) ) {
+			allocate(alignment<T>::value, sizeof(T)*num_elements, security_policy::trivial_marker());
+			return reinterpret_cast<T*>(top_object());
+		} else {
+			return NULL;
+		}
+	}
+
+	struct no_initializer {
+		void operator()(void * const /*p*/) const {}
+	};
+
+	template<typename T>
+	struct value_initializer {
+		void operator()(void * const p) const { new(p) T(); }
+	};
+
+	template<typename T, typename T1>
+	struct copy_initializer {
+		explicit copy_initializer(const T1 &a1) : a1(a1) {}
+		void operator()(void * const p) const { new(p) T(a1); }
+		const T1 &a1;
+	};
+
+	///the element count stored in front of the chunk_header of arrays with non-trivial destructors
+	static size_type& array_count(chunk_header * const chead) {
+		return *(reinterpret_cast<size_type*>(chead) - 1);
+	}
+
+	///the prefix of an array with an element count, the first word holds the chunk start, see allocate
+	enum { counted_prefix = 2*sizeof(size_type) };
+	///tag in the low bit of prev_dtor, chunk_headers are aligned so the bit is otherwise 0
+	enum { has_chunk_offset = 1 };
+
+	///the distance from the start of a chunk with a prefix to its chunk_header
+	static size_type& chunk_offset(chunk_header * const chead) {
+		return *(reinterpret_cast<size_type*>(chead) - 2);
+	}
+
+	///where the memory of chead starts, including its prefix and the padding in front of the chunk_header
+	static byte_type* begin_of_chunk(chunk_header * const chead) {
+		byte_type * const p = reinterpret_cast<byte_type*>(chead);
+		return reinterpret_cast<size_type>(chead->prev_dtor) & has_chunk_offset ? p - chunk_offset(chead) : p;
+	}
+
+	static chunk_header* prev_dtor_of(const chunk_header * const chead) {
+		return reinterpret_cast<chunk_header*>(reinterpret_cast<size_type>(chead->prev_dtor) & ~static_cast<size_type>(has_chunk_offset));
+	}
+
+	template<typename T>
+	static void destroy_elements(T * const array, size_type num_elements) {
+		while(num_elements) {
+			num_elements--;
+			array[num_elements].~T();
+		}
 	}
 
 	template<typename T>
-	void allocate() {
-		allocate(alignment<T>::value, sizeof(T), xor_fptr(&arena_detail::call_dtor<T>));
+	static void call_array_dtor(void * const obj) {
+		T * const array = static_cast<T*>(obj);
+		destroy_elements(array, array_count(to_chunk_header(to_typed_void(obj))));
+	}
+
+	/**
+	 * \brief allocate an array chunk and construct its elements with init
+	 */
+	template<typename T, typename Initializer>
+	T* construct_array(size_type const num_elements, Initializer init) {
+		return construct_array<T>(num_elements, init, alignment<T>::value, sizeof(T)*num_elements);
+	}
+
+	/**
+	 * \brief allocate an array chunk of array_bytes aligned to align_to and construct its elements with init
+	 *
+	 * array_bytes may be larger than the elements, e.g. for tail padding.
+	 */
+	template<typename T, typename Initializer>
+	T* construct_array(size_type const num_elements, Initializer init, size_type const align_to, size_type const array_bytes) {
+		const bool has_count = !has_trivial_destructor<T>::value;
+		const size_type prefix = has_count ? static_cast<size_type>(counted_prefix) : 0;
+
+		T *array = NULL;
+		if(hole_policy::enabled && !has_count) {
+			array = reinterpret_cast<T*>(take_hole(align_to, array_bytes));
+		}
+		if(!array) {
+			if(!mem_available(align_to, prefix, array_bytes) && !grow(align_to, prefix + array_bytes)) {
+				return NULL;
+			}
+			if(has_count) {
+				allocate(align_to, array_bytes, encode_dtor(&call_array_dtor<T>), prefix);
+				array_count(top_chunk) = num_elements;
+			} else {
+				allocate(align_to, array_bytes, security_policy::trivial_marker());
+			}
+			array = reinterpret_cast<T*>(top_object());
+		}
+		size_type i = 0;
+		try {
+			for(; i<num_elements; i++) {
+				init(array+i);
+			}
+		} catch(...) {
+			destroy_elements(array, i);
+			unallocate(to_typed_void(array), array_bytes);
+			throw;
+		}
+		return array;
+	}
+
+	/**
+	 * \brief allocate a single object chunk for alloc_aligned and construct the object with init
+	 */
+	template<typename T, typename Initializer>
+	T* construct_aligned(const alignment_request &align, Initializer init) {
+		const size_type align_to = aligned_to<T>(align);
+		const size_type bytes = aligned_bytes(align, align_to, sizeof(T));
+
+		byte_type *obj = NULL;
+		if(hole_policy::enabled && has_trivial_destructor<T>::value) {
+			obj = take_hole(align_to, bytes);
+		}
+		if(!obj) {
+			if(!mem_available(align_to, 0, bytes) && !grow(align_to, bytes)) {
+				return NULL;
+			}
+			allocate(align_to, bytes, encoded_dtor_of<T>());
+			obj = top_object();
+		}
+		try {
+			init(obj);
+		} catch(...) {
+			unallocate(to_typed_void(obj), bytes);
+			throw;
+		}
+		return reinterpret_cast<T*>(obj);
+	}
+
+	///the alignment of an alloc_aligned chunk, never below what T or the chunk_header need
+	template<typename T>
+	static size_type aligned_to(const alignment_request &align) {
+		BOOST_ASSERT_MSG((align.align_to & (align.align_to-1)) == 0, "alignment is not a power of two");
+		return align.align_to > alignment<T>::value ? align.align_to : alignment<T>::value;
+	}
+
+	/**
+	 * \brief place a chunk_header and size bytes aligned to align_to below the scratch stack
+	 *
+	 * The chunk is laid out like one on the main stack, prefix bytes are
+	 * reserved in front of the chunk_header. Returns NULL if it does not fit
+	 * between the top of stack and the scratch stack.
+	 */
+	byte_type* allocate_scratch(size_type const align_to, size_type const size, dtor_fptr const encoded_dtor, size_type const prefix) {
+		byte_type * const end = memory.end_of_mem();
+		const size_type available = static_cast<size_type>(end - tos);
+		if(memory.is_chained() || size > available) {
+			return NULL;
+		}
+		const size_type padding = reinterpret_cast<size_type>(end - size) & (align_to - 1);
+		if(prefix + max_aligned_sizeof<chunk_header>::value + padding + size > available) {
+			return NULL;
+		}
+		byte_type * const obj = end - size - padding;
+		chunk_header * const chead = to_chunk_header(to_typed_void(obj));
+		chead->prev = scratch_top_chunk;
+		chead->dtor = encoded_dtor;
+		chead->checksum = security_policy::make_checksum(chead->prev, chead->dtor);
+		chead->prev_dtor = NULL;
+		scratch_top_chunk = chead;
+		memory.set_end_of_mem(reinterpret_cast<byte_type*>(chead) - prefix);
+		return obj;
+	}
+
+	/**
+	 * \brief allocate a scratch chunk and construct its elements with init
+	 *
+	 * Arrays of types with non-trivial destructors store their element count like on the main stack.
+	 */
+	template<typename T, typename Initializer>
+	T* construct_scratch(size_type const num_elements, Initializer init, bool const is_array) {
+		const bool has_count = is_array && !has_trivial_destructor<T>::value;
+		const scratch_marker m = mark_scratch();
+		T * const array = reinterpret_cast<T*>(
+			allocate_scratch(
+				alignment<T>::value,
+				sizeof(T)*num_elements,
+				has_count ? encode_dtor(&call_array_dtor<T>) : encoded_dtor_of<T>(),
+				has_count ? sizeof(size_type) : 0
+			)
+		);
+		if(!array) {
+			return NULL;
+		}
+		if(has_count) {
+			array_count(scratch_top_chunk) = num_elements;
+		}
+		size_type i = 0;
+		try {
+			for(; i<num_elements; i++) {
+				init(array+i);
+			}
+		} catch(...) {
+			destroy_elements(array, i);
+			scratch_top_chunk = m.top_chunk;
+			memory.set_end_of_mem(m.end);
+			throw;
+		}
+		return array;
+	}
+
+	///destruct the scratch objects above stop, without stats since they never reached the stats policy
+	void destruct_scratch_above(chunk_header * const stop) {
+		while(scratch_top_chunk != stop) {
+			chunk_header * const chead = scratch_top_chunk;
+			scratch_top_chunk = chead->prev;
+			if(chead->dtor != security_policy::trivial_marker()) {
+				dtor_fptr const dtor = mark_as_destructed(chead);
+				if(dtor) {
+					//might throw
+					dtor(to_object(chead));
+				}
+			}
+		}
+	}
+
+	void destruct_scratch_above_nothrow(chunk_header * const stop) {
+		for(;;) {
+			try {
+				destruct_scratch_above(stop);
+				return;
+			} catch(...) {
+			}
+		}
+	}
+
+	///release the pages between the new top of stack plus the watermark and old_tos
+	void decommit_after_rewind(byte_type * const old_tos) {
+		if(BOOST_LIKELY(decommit_watermark == no_decommit()) || !is_in_current_block(old_tos) || old_tos < tos) {
+			return;
+		}
+		if(static_cast<size_type>(old_tos - tos) > decommit_watermark) {
+			arena_detail::decommit_pages(tos + decommit_watermark, old_tos);
+		}
+	}
+
+	///size rounded up to align_to when the tail is to be padded
+	static size_type aligned_bytes(const alignment_request &align, size_type const align_to, size_type const size) {
+		return align.pad_tail ? (size + align_to - 1) & ~(align_to - 1) : size;
 	}
 	
 	
@@ -588,6 +1935,7 @@ private:
 
 	void pop(chunk_header * const chead, typed_void * const obj) {
 		dtor_fptr dtor = mark_as_destructed(chead);	
+		stats_hooks().on_destruct();
 		deallocate_as_possible();
 		//might throw
 		dtor(obj);
@@ -605,10 +1953,72 @@ private:
 
 	void destruct(chunk_header * const chead, typed_void * const obj) {
 		dtor_fptr dtor = mark_as_destructed(chead);
+		stats_hooks().on_destruct();
 		//might throw
 		dtor(obj);
 	}
 
+	/**
+	 * \brief destruct all live objects with non-trivial destructors above stop
+	 *
+	 * Only follows the prev_dtor links, the memory is not reclaimed.
+	 * Chunks of trivially destructible objects are never touched, and since
+	 * an object follows its chunk_header, calling a destructor touches the same
+	 * cache lines as reading the link. The next chunk_header on the list is
+	 * prefetched while the current destructor runs.
+	 */
+	void destruct_above(chunk_header * const stop) {
+		while(top_dtor_chunk != stop) {
+			chunk_header * const chead = top_dtor_chunk;
+			top_dtor_chunk = prev_dtor_of(chead);
+			BOOST_ARENA_PREFETCH(top_dtor_chunk);
+			if(!is_free(chead)) {
+				destruct(chead);
+			}
+		}
+	}
+
+	///destruct_above, but keep going when destructors throw
+	void destruct_above_nothrow(chunk_header * const stop) {
+		for(;;) {
+			try {
+				destruct_above(stop);
+				return;
+			} catch(...) {
+			}
+		}
+	}
+
+	///reclaim all memory, all objects must be destructed
+	void reset() {
+		while(memory.is_chained()) {
+			memory.pop_block();
+		}
+		top_chunk = NULL;
+		tos = memory.mem();
+		scratch_top_chunk = NULL;
+		memory.set_end_of_mem(memory.end_of_block());
+		holes().clear();
+		stats_hooks().on_reset();
+	}
+
+	///reclaim the memory above a marker, all objects above it must be destructed
+	void reset_to(const marker &m) {
+		stats_hooks().on_rewind(m.size);
+		if(stats_policy::tracks_chunks || !holes().empty()) {
+			for(chunk_header *c = top_chunk; c != m.top_chunk; c = c->prev) {
+				stats_hooks().on_reclaim(to_object(c), is_free(c));
+				forget_hole(c);
+			}
+		}
+		while(memory.is_chained() && (memory.used_below() > m.size || !is_in_current_block(m.tos))) {
+			memory.pop_block();
+		}
+		tos = m.tos;
+		top_chunk = m.top_chunk;
+		deallocate_as_possible();
+	}
+
 	static chunk_header *to_chunk_header(typed_void * const obj) {
 		return reinterpret_cast<chunk_header*>(reinterpret_cast<byte_type*>(obj) - max_aligned_sizeof<chunk_header>::value);
 	}
@@ -619,14 +2029,24 @@ private:
 		return to_typed_void(reinterpret_cast<byte_type*>(chead)+max_aligned_sizeof<chunk_header>::value);
 	}
 
+	/**
+	 * \brief check a chunk_header as far as the security policy demands it
+	 */
+	bool is_trusted(const chunk_header * const chead) const {
+		return
+			(!security_policy::verify_bounds || memory.contains(chead)) &&
+			(!security_policy::verify_checksum || security_policy::checksum_ok(chead->prev, chead->dtor, chead->checksum));
+	}
+
 	/**
 	 * \brief mark an item on the obstack as free and decrypt the dtor pointer
 	 */
 	dtor_fptr mark_as_destructed(chunk_header * const chead) const {
-		BOOST_ASSERT_MSG(is_valid(chead), "invalid destruction detected");
-		if(is_valid(chead)) {
-			dtor_fptr const dtor = xor_fptr(chead->dtor);
-			chead->dtor = arena_detail::free_marker_dtor_xor;
+		const bool trusted = is_trusted(chead);
+		BOOST_ASSERT_MSG(trusted, "invalid destruction detected");
+		if(trusted) {
+			dtor_fptr const dtor = security_policy::decode(chead->dtor);
+			chead->dtor = security_policy::free_marker();
 			return dtor;
 		} else {
 			return NULL;
@@ -640,16 +2060,54 @@ private:
 	 * complexity: O(k) where k is the number of consecutive destructed chunks
 	 */
 	void deallocate_as_possible() {
-		while(top_chunk && (top_chunk->dtor == arena_detail::free_marker_dtor_xor)) {
+		while(top_chunk && is_free(top_chunk)) {
+			if(top_chunk == top_dtor_chunk) {
+				top_dtor_chunk = prev_dtor_of(top_chunk);
+			}
+			forget_hole(top_chunk);
 			//deallocate memory
-			tos = reinterpret_cast<byte_type*>(top_chunk);
+			stats_hooks().on_reclaim(to_object(top_chunk), true);
+			tos = begin_of_chunk(top_chunk);
 			top_chunk = top_chunk->prev;
+			release_empty_blocks();
+		}
+	}
+
+	/**
+	 * \brief pop chained blocks that contain no more chunks
+	 *
+	 * When no chunk is left, also the padding and array counts in front
+	 * of the first chunk are reclaimed.
+	 */
+	void release_empty_blocks() {
+		while(memory.is_chained() && !is_in_current_block(top_chunk)) {
+			tos = memory.pop_block();
 		}
+		if(!top_chunk) {
+			tos = memory.mem();
+		}
+	}
+
+	bool is_in_current_block(const chunk_header * const chead) const {
+		return
+			reinterpret_cast<const byte_type*>(chead) >= memory.mem() &&
+			reinterpret_cast<const byte_type*>(chead) < memory.end_of_mem();
+	}
+
+	///a top of stack position is in the current block if it is inside or at its end
+	bool is_in_current_block(const byte_type * const p) const {
+		return p >= memory.mem() && p <= memory.end_of_mem();
 	}
 
 private:
 	///points to the chunk_header before the current tos
 	chunk_header* top_chunk;
+	///points to the topmost chunk_header with a non-trivial destructor
+	chunk_header* top_dtor_chunk;
+	///points to the chunk_header of the lowest object on the scratch stack
+	chunk_header* scratch_top_chunk;
+	///decommit when dealloc_all or rewind_to frees more than this many bytes of the current block
+	size_type decommit_watermark;
 	///top of stack pointer
 	byte_type* tos;
 	//assures deallocation of memory upon destruction
@@ -0,0 +1,91 @@
+#ifndef BOOST_ARENA_OBSTACK_ALLOCATOR_HPP
+#define BOOST_ARENA_OBSTACK_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+
+#include <boost/limits.hpp>
+#include <boost/throw_exception.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \class obstack_allocator
+ * \brief A standard allocator that places the storage of containers on an obstack
+ *
+ * The allocator only holds a pointer to the arena, so all copies and rebound
+ * copies allocate from the same obstack and compare equal.
+ * Arena can be an obstack or a bump_obstack. On a bump_obstack the element
+ * storage is header-less, on an obstack every allocation carries a chunk_header.
+ * In both cases memory that is deallocated on the top of stack is reclaimed
+ * immediately, everything else when the arena is rewound.
+ *
+ * The allocator is stateful and does not propagate on container assignment or swap.
+ * To allocate nested containers (e.g. a vector of strings) in the same arena,
+ * wrap it into a scoped_allocator_adaptor.
+ */
+template<typename T, class Arena = obstack>
+class obstack_allocator {
+public:
+	typedef Arena     arena_type;
+	typedef T         value_type;
+	typedef T*        pointer;
+	typedef T&        reference;
+	typedef const T*  const_pointer;
+	typedef const T&  const_reference;
+	typedef size_t    size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U>
+	struct rebind {
+		typedef obstack_allocator<U, arena_type> other;
+	};
+
+	obstack_allocator(arena_type &arena) : arena(&arena) {}
+
+	template<typename U>
+	obstack_allocator(const obstack_allocator<U, arena_type> &other) : arena(&other.get_arena()) {}
+
+	arena_type& get_arena() const { return *arena; }
+
+	pointer        address(reference x) const { return &x; }
+	const_pointer  address(const_reference x) const { return &x; }
+
+	pointer allocate(size_type n, const void * /*hint*/ = 0) {
+		pointer const p = arena->template alloc_storage<value_type>(n);
+		if(!p) {
+			boost::throw_exception(std::bad_alloc());
+		}
+		return p;
+	}
+
+	void deallocate(pointer p, size_type n) {
+		arena->dealloc(p, n*sizeof(value_type));
+	}
+
+	size_type      max_size() const throw() { return std::numeric_limits<size_type>::max() / sizeof(value_type); }
+	void           construct(pointer p, const_reference val) { new((void*)p) T(val); }
+	void           destroy(pointer p) { ((T*)p)->~T(); }
+
+private:
+	arena_type *arena;
+};
+
+template<typename T, typename U, class Arena>
+inline bool operator==(const obstack_allocator<T, Arena> &a, const obstack_allocator<U, Arena> &b) {
+	return &a.get_arena() == &b.get_arena();
+}
+
+template<typename T, typename U, class Arena>
+inline bool operator!=(const obstack_allocator<T, Arena> &a, const obstack_allocator<U, Arena> &b) {
+	return !(a == b);
+}
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_OBSTACK_ALLOCATOR_HPP
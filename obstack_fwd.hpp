@@ -8,9 +8,24 @@
 namespace boost {
 namespace arena {
 
-template<class A = std::allocator<max_align_t> > class basic_obstack;
+struct null_stats;
+struct no_hole_reuse;
+namespace security { struct hardened; }
+
+template<
+	class A = std::allocator<max_align_t>,
+	class S = null_stats,
+	class P = security::hardened,
+	class H = no_hole_reuse
+> class basic_obstack;
 typedef basic_obstack<> obstack;
 
+template<class A = std::allocator<max_align_t> > class basic_bump_obstack;
+typedef basic_bump_obstack<> bump_obstack;
+
+template<class A = std::allocator<max_align_t> > class basic_concurrent_obstack;
+typedef basic_concurrent_obstack<> concurrent_obstack;
+
 
 } //namespace arena
 } //namespace boost
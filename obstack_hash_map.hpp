@@ -0,0 +1,260 @@
+#ifndef BOOST_ARENA_OBSTACK_HASH_MAP_HPP
+#define BOOST_ARENA_OBSTACK_HASH_MAP_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <utility>
+
+#include <boost/assert.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/utility.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \class obstack_hash_map
+ * \brief An open-addressing hash map with its slots on an obstack
+ *
+ * The entries live in one array of a power of two slots with linear
+ * probing and a separate array of slot states, so lookups touch one or two
+ * contiguous runs of memory and there is no allocation per entry.
+ * Erased entries leave a tombstone behind. When live entries and tombstones
+ * fill three quarters of the slots, the map is rehashed into a new
+ * array, twice as large unless most of the load were tombstones,
+ * and the old arrays are deallocated.
+ *
+ * Destructing the map only destructs the entries, a no-op for trivially
+ * destructible keys and values; the arrays are reclaimed with the arena.
+ * Allocation failures are reported by returning NULL.
+ */
+template<
+	typename K,
+	typename V,
+	class Hash = boost::hash<K>,
+	class Pred = std::equal_to<K>,
+	class Arena = obstack
+>
+class obstack_hash_map
+	: private noncopyable
+{
+public:
+	typedef Arena arena_type;
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<const K, V> value_type;
+	typedef std::size_t size_type;
+
+	///an empty map, the slots are allocated for about expected_size entries on the first insert
+	explicit obstack_hash_map(arena_type &arena, size_type const expected_size = 0, const Hash &hash = Hash(), const Pred &equal = Pred()) :
+		arena(arena),
+		hash(hash),
+		equal(equal),
+		entries(NULL),
+		states(NULL),
+		num_slots(0),
+		num_elements(0),
+		num_tombstones(0),
+		first_num_slots(slots_for(expected_size))
+	{}
+
+	~obstack_hash_map() {
+		destroy_entries();
+	}
+
+	/**
+	 * \brief insert key with value unless key is already in the map
+	 *
+	 * Returns the value stored for key, NULL if the arena is full.
+	 */
+	V* insert(const K &key, const V &value) {
+		if(4*(num_elements + num_tombstones + 1) > 3*num_slots && !rehash()) {
+			return NULL;
+		}
+		const size_type mask = num_slots - 1;
+		size_type free_slot = num_slots;
+		for(size_type i = hash(key) & mask; ; i = (i + 1) & mask) {
+			if(states[i] == empty_slot) {
+				if(free_slot == num_slots) {
+					free_slot = i;
+				}
+				break;
+			}
+			if(states[i] == tombstone) {
+				if(free_slot == num_slots) {
+					free_slot = i;
+				}
+			} else if(equal(entries[i].first, key)) {
+				return &entries[i].second;
+			}
+		}
+		new(entries + free_slot) value_type(key, value);
+		if(states[free_slot] == tombstone) {
+			num_tombstones--;
+		}
+		states[free_slot] = full_slot;
+		num_elements++;
+		return &entries[free_slot].second;
+	}
+
+	///the value stored for key, NULL if there is none
+	V* find(const K &key) {
+		const size_type i = find_slot(key);
+		return i < num_slots ? &entries[i].second : NULL;
+	}
+	const V* find(const K &key) const {
+		const size_type i = find_slot(key);
+		return i < num_slots ? &entries[i].second : NULL;
+	}
+
+	///destruct the entry of key, false if there is none
+	bool erase(const K &key) {
+		const size_type i = find_slot(key);
+		if(i == num_slots) {
+			return false;
+		}
+		entries[i].~value_type();
+		states[i] = tombstone;
+		num_elements--;
+		num_tombstones++;
+		return true;
+	}
+
+	///destruct all entries, the slots are kept
+	void clear() {
+		destroy_entries();
+		if(states) {
+			std::memset(states, empty_slot, num_slots);
+		}
+		num_elements = 0;
+		num_tombstones = 0;
+	}
+
+	///call f with every entry, in slot order
+	template<typename F>
+	F for_each(F f) {
+		for(size_type i=0; i<num_slots; i++) {
+			if(states[i] == full_slot) {
+				f(entries[i]);
+			}
+		}
+		return f;
+	}
+
+	size_type size() const { return num_elements; }
+	bool empty() const { return num_elements == 0; }
+	///the number of slots, a power of two
+	size_type capacity() const { return num_slots; }
+
+private:
+	enum slot_state { empty_slot = 0, full_slot = 1, tombstone = 2 };
+	enum { min_slots = 16 };
+
+	///the smallest power of two number of slots that holds size entries below the maximum load
+	static size_type slots_for(size_type const size) {
+		size_type n = min_slots;
+		while(3*n < 4*size) {
+			n *= 2;
+		}
+		return n;
+	}
+
+	size_type find_slot(const K &key) const {
+		if(!num_elements) {
+			return num_slots;
+		}
+		const size_type mask = num_slots - 1;
+		for(size_type i = hash(key) & mask; states[i] != empty_slot; i = (i + 1) & mask) {
+			if(states[i] == full_slot && equal(entries[i].first, key)) {
+				return i;
+			}
+		}
+		return num_slots;
+	}
+
+	/**
+	 * \brief move all entries into new arrays, dropping the tombstones
+	 */
+	bool rehash() {
+		const size_type new_num_slots =
+			!num_slots ? first_num_slots :
+			(4*(num_elements + 1) > 3*num_slots/2 ? 2*num_slots : num_slots);
+		value_type * const new_entries = arena.template alloc_storage<value_type>(new_num_slots);
+		unsigned char * const new_states = new_entries ? arena.template alloc_storage<unsigned char>(new_num_slots) : NULL;
+		if(!new_states) {
+			if(new_entries) {
+				arena.dealloc(new_entries, new_num_slots*sizeof(value_type));
+			}
+			return false;
+		}
+		std::memset(new_states, empty_slot, new_num_slots);
+
+		const size_type mask = new_num_slots - 1;
+		size_type i = 0;
+		try {
+			for(; i<num_slots; i++) {
+				if(states[i] == full_slot) {
+					size_type j = hash(entries[i].first) & mask;
+					while(new_states[j] != empty_slot) {
+						j = (j + 1) & mask;
+					}
+					new(new_entries + j) value_type(entries[i]);
+					new_states[j] = full_slot;
+				}
+			}
+		} catch(...) {
+			if(!has_trivial_destructor<value_type>::value) {
+				for(size_type j=0; j<new_num_slots; j++) {
+					if(new_states[j] == full_slot) {
+						new_entries[j].~value_type();
+					}
+				}
+			}
+			arena.dealloc(new_states, new_num_slots);
+			arena.dealloc(new_entries, new_num_slots*sizeof(value_type));
+			throw;
+		}
+
+		destroy_entries();
+		if(entries) {
+			arena.dealloc(entries, num_slots*sizeof(value_type));
+			arena.dealloc(states, num_slots);
+		}
+		entries = new_entries;
+		states = new_states;
+		num_slots = new_num_slots;
+		num_tombstones = 0;
+		return true;
+	}
+
+	void destroy_entries() {
+		if(!has_trivial_destructor<value_type>::value) {
+			for(size_type i=0; i<num_slots; i++) {
+				if(states[i] == full_slot) {
+					entries[i].~value_type();
+				}
+			}
+		}
+	}
+
+	arena_type &arena;
+	Hash hash;
+	Pred equal;
+	value_type *entries;
+	unsigned char *states;
+	size_type num_slots;
+	size_type num_elements;
+	size_type num_tombstones;
+	size_type const first_num_slots;
+};
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_OBSTACK_HASH_MAP_HPP
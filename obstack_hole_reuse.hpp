@@ -0,0 +1,152 @@
+#ifndef BOOST_ARENA_OBSTACK_HOLE_REUSE_HPP
+#define BOOST_ARENA_OBSTACK_HOLE_REUSE_HPP
+
+#include <cstddef>
+
+namespace boost {
+namespace arena {
+
+/**
+ * \brief the default hole policy of basic_obstack: memory of objects
+ * deallocated out of order stays blocked until everything above it is freed
+ */
+struct no_hole_reuse {
+	enum { enabled = 0 };
+
+	static std::size_t min_hole_size() { return 0; }
+	bool empty() const { return true; }
+	bool can_take(std::size_t /*size*/, std::size_t /*align_to*/) const { return false; }
+	void* take(std::size_t /*size*/, std::size_t /*align_to*/) { return NULL; }
+	void record(void * /*obj*/, std::size_t /*size*/) {}
+	void unlink(void * /*obj*/) {}
+	void clear() {}
+};
+
+/**
+ * \brief a hole policy that reuses the memory of objects deallocated out of order
+ *
+ * When an object that is not on the top of stack is deallocated with
+ * dealloc(obj, size), its memory is recorded as a hole in one of a few
+ * size-segregated free lists. Later allocations of trivially destructible
+ * objects and of uninitialized storage that fit into a hole are placed there
+ * instead of on the top of stack. The free list nodes live in the holes
+ * themselves, so holes smaller than min_hole_size are not recorded.
+ *
+ * Size class k holds holes of [min_hole_size << k, min_hole_size << (k+1)) bytes,
+ * the last class holds everything larger. Allocations are taken from the
+ * first non-empty larger class, or with a short first-fit scan of their own class.
+ *
+ * complexity: O(1) for recording, taking and unlinking a hole
+ */
+class hole_reuse {
+public:
+	enum { enabled = 1 };
+	enum { num_classes = 8 };
+	///number of nodes of the own size class that are checked before giving up
+	enum { max_scan = 4 };
+
+	hole_reuse() : num_holes(0) {
+		for(std::size_t k=0; k<num_classes; k++) {
+			heads[k] = NULL;
+		}
+	}
+
+	static std::size_t min_hole_size() { return sizeof(node); }
+
+	bool empty() const { return num_holes == 0; }
+	///the number of recorded holes
+	std::size_t size() const { return num_holes; }
+
+	bool can_take(std::size_t const size, std::size_t const align_to) const {
+		return num_holes && find(size, align_to) != NULL;
+	}
+
+	///take a hole of at least size bytes aligned to align_to out of the free lists, NULL if there is none
+	void* take(std::size_t const size, std::size_t const align_to) {
+		if(!num_holes) {
+			return NULL;
+		}
+		node * const n = find(size, align_to);
+		if(n) {
+			unlink(n);
+		}
+		return n;
+	}
+
+	void record(void * const obj, std::size_t const size) {
+		node * const n = static_cast<node*>(obj);
+		const std::size_t k = class_of(size);
+		n->size = size;
+		n->prev = NULL;
+		n->next = heads[k];
+		if(heads[k]) {
+			heads[k]->prev = n;
+		}
+		heads[k] = n;
+		num_holes++;
+	}
+
+	///remove a recorded hole, e.g. because the top of stack is rewound below it
+	void unlink(void * const obj) {
+		node * const n = static_cast<node*>(obj);
+		if(n->prev) {
+			n->prev->next = n->next;
+		} else {
+			heads[class_of(n->size)] = n->next;
+		}
+		if(n->next) {
+			n->next->prev = n->prev;
+		}
+		num_holes--;
+	}
+
+	void clear() {
+		for(std::size_t k=0; k<num_classes; k++) {
+			heads[k] = NULL;
+		}
+		num_holes = 0;
+	}
+
+private:
+	struct node {
+		node *prev;
+		node *next;
+		std::size_t size;
+	};
+
+	static std::size_t class_of(std::size_t const size) {
+		std::size_t k = 0;
+		while(k+1 < num_classes && size >= (min_hole_size() << (k+1))) {
+			k++;
+		}
+		return k;
+	}
+
+	static bool fits(const node * const n, std::size_t const size, std::size_t const align_to) {
+		return n->size >= size && reinterpret_cast<std::size_t>(n) % align_to == 0;
+	}
+
+	node* find(std::size_t const size, std::size_t const align_to) const {
+		const std::size_t own = class_of(size);
+		for(std::size_t k=own+1; k<num_classes; k++) {
+			if(heads[k] && fits(heads[k], size, align_to)) {
+				return heads[k];
+			}
+		}
+		node *n = heads[own];
+		for(std::size_t i=0; n && i<max_scan; i++, n = n->next) {
+			if(fits(n, size, align_to)) {
+				return n;
+			}
+		}
+		return NULL;
+	}
+
+	node *heads[num_classes];
+	std::size_t num_holes;
+};
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_OBSTACK_HOLE_REUSE_HPP
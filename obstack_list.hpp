@@ -0,0 +1,169 @@
+#ifndef BOOST_ARENA_OBSTACK_LIST_HPP
+#define BOOST_ARENA_OBSTACK_LIST_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+
+#include <boost/assert.hpp>
+#include <boost/utility.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \class obstack_list
+ * \brief A singly linked list with its nodes on an obstack
+ *
+ * Every node is one uninitialized storage chunk on the arena holding the
+ * link and the element, so consecutively pushed nodes are adjacent in memory.
+ * pop_front deallocates the node, which reclaims it when it is the top of
+ * stack and lets the hole_reuse policy reuse it otherwise.
+ *
+ * Destructing the list only destructs the elements, a no-op for trivially
+ * destructible types; the nodes are reclaimed with the arena.
+ * Allocation failures are reported by returning NULL.
+ */
+template<typename T, class Arena = obstack>
+class obstack_list
+	: private noncopyable
+{
+private:
+	struct node {
+		node *next;
+		T value;
+	};
+
+	template<typename V, typename N>
+	class basic_iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef V value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef V* pointer;
+		typedef V& reference;
+
+		basic_iterator() : n(NULL) {}
+		explicit basic_iterator(N * const n) : n(n) {}
+		///an iterator converts to a const_iterator
+		template<typename V2, typename N2>
+		basic_iterator(const basic_iterator<V2, N2> &other) : n(other.n) {}
+
+		reference operator*() const { return n->value; }
+		pointer operator->() const { return &n->value; }
+		basic_iterator& operator++() { n = n->next; return *this; }
+		basic_iterator operator++(int) { basic_iterator old(*this); n = n->next; return old; }
+		bool operator==(const basic_iterator &other) const { return n == other.n; }
+		bool operator!=(const basic_iterator &other) const { return n != other.n; }
+
+	private:
+		template<typename V2, typename N2> friend class basic_iterator;
+		N *n;
+	};
+
+public:
+	typedef Arena arena_type;
+	typedef T value_type;
+	typedef std::size_t size_type;
+	typedef basic_iterator<T, node> iterator;
+	typedef basic_iterator<const T, const node> const_iterator;
+
+	explicit obstack_list(arena_type &arena) :
+		arena(arena),
+		head(NULL),
+		tail(NULL),
+		num_elements(0)
+	{}
+
+	~obstack_list() {
+		if(!has_trivial_destructor<T>::value) {
+			for(node *n = head; n; n = n->next) {
+				n->value.~T();
+			}
+		}
+	}
+
+	///insert a copy of value at the front, NULL if the arena is full
+	T* push_front(const T &value) {
+		node * const n = make_node(value);
+		if(n) {
+			n->next = head;
+			head = n;
+			if(!tail) {
+				tail = n;
+			}
+		}
+		return n ? &n->value : NULL;
+	}
+
+	///append a copy of value, NULL if the arena is full
+	T* push_back(const T &value) {
+		node * const n = make_node(value);
+		if(n) {
+			n->next = NULL;
+			if(tail) {
+				tail->next = n;
+			} else {
+				head = n;
+			}
+			tail = n;
+		}
+		return n ? &n->value : NULL;
+	}
+
+	///destruct the first element and deallocate its node
+	void pop_front() {
+		BOOST_ASSERT_MSG(head, "pop_front on an empty obstack_list");
+		node * const n = head;
+		head = n->next;
+		if(!head) {
+			tail = NULL;
+		}
+		num_elements--;
+		n->value.~T();
+		arena.dealloc(n, sizeof(node));
+	}
+
+	T& front() { return head->value; }
+	const T& front() const { return head->value; }
+	T& back() { return tail->value; }
+	const T& back() const { return tail->value; }
+
+	iterator begin() { return iterator(head); }
+	iterator end() { return iterator(); }
+	const_iterator begin() const { return const_iterator(head); }
+	const_iterator end() const { return const_iterator(); }
+
+	size_type size() const { return num_elements; }
+	bool empty() const { return head == NULL; }
+
+private:
+	node* make_node(const T &value) {
+		node * const n = arena.template alloc_storage<node>(1);
+		if(!n) {
+			return NULL;
+		}
+		try {
+			new(&n->value) T(value);
+		} catch(...) {
+			arena.dealloc(n, sizeof(node));
+			throw;
+		}
+		num_elements++;
+		return n;
+	}
+
+	arena_type &arena;
+	node *head;
+	node *tail;
+	size_type num_elements;
+};
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_OBSTACK_LIST_HPP
@@ -0,0 +1,97 @@
+#ifndef BOOST_ARENA_OBSTACK_PTR_HPP
+#define BOOST_ARENA_OBSTACK_PTR_HPP
+
+#include <boost/config.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+#include "obstack_allocator.hpp"
+
+#ifndef BOOST_NO_CXX11_SMART_PTR
+#include <memory>
+#endif
+
+namespace boost {
+namespace arena {
+
+/**
+ * \brief a deleter for smart pointers to objects allocated with basic_obstack::alloc
+ *
+ * Deleting an object deallocates it from its obstack, which calls the destructor
+ * and reclaims the memory if it is the top of stack.
+ * The obstack must outlive all smart pointers into it.
+ */
+template<class Arena = obstack>
+class obstack_deleter {
+public:
+	typedef Arena arena_type;
+
+	obstack_deleter() : arena(NULL) {}
+	explicit obstack_deleter(arena_type &arena) : arena(&arena) {}
+
+	arena_type* get_arena() const { return arena; }
+
+	///p must point to the object as it was returned by alloc, not to a base class subobject
+	template<typename T>
+	void operator()(T * const p) const {
+		if(arena) {
+			arena->dealloc(const_cast<void*>(static_cast<const void*>(p)), sizeof(T));
+		}
+	}
+
+private:
+	arena_type *arena;
+};
+
+#if !defined(BOOST_NO_CXX11_SMART_PTR) && !defined(BOOST_NO_CXX11_TEMPLATE_ALIASES) && defined(BOOST_ARENA_HAS_VARIADIC_ALLOC)
+/**
+ * \brief a unique_ptr that deallocates its object from an obstack
+ */
+template<typename T, class Arena = obstack>
+using obstack_unique_ptr = std::unique_ptr<T, obstack_deleter<Arena> >;
+
+/**
+ * \brief allocate an object on the obstack and hand it to an obstack_unique_ptr
+ *
+ * The returned pointer is empty when the obstack is full.
+ */
+template<typename T, class Arena, typename... Args>
+obstack_unique_ptr<T, Arena> make_obstack_unique(Arena &arena, Args&&... args) {
+	return obstack_unique_ptr<T, Arena>(
+		arena.template alloc<T>(std::forward<Args>(args)...),
+		obstack_deleter<Arena>(arena)
+	);
+}
+#endif
+
+/**
+ * \brief create a shared_ptr whose object and control block both live on the obstack
+ *
+ * Uses a single allocation from the obstack through obstack_allocator,
+ * there is no hidden heap allocation. The object is destructed when the last
+ * reference is gone, the memory is reclaimed if it is the top of stack then.
+ * Throws std::bad_alloc when the obstack is full.
+ * The obstack must outlive all shared_ptrs into it.
+ */
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+template<typename T, class Arena, typename... Args>
+shared_ptr<T> make_obstack_shared(Arena &arena, Args&&... args) {
+	return boost::allocate_shared<T>(obstack_allocator<T, Arena>(arena), std::forward<Args>(args)...);
+}
+#else
+template<typename T, class Arena>
+shared_ptr<T> make_obstack_shared(Arena &arena) {
+	return boost::allocate_shared<T>(obstack_allocator<T, Arena>(arena));
+}
+template<typename T, class Arena, typename T1>
+shared_ptr<T> make_obstack_shared(Arena &arena, const T1 &a1) {
+	return boost::allocate_shared<T>(obstack_allocator<T, Arena>(arena), a1);
+}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_OBSTACK_PTR_HPP
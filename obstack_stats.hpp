@@ -0,0 +1,169 @@
+#ifndef BOOST_ARENA_OBSTACK_STATS_HPP
+#define BOOST_ARENA_OBSTACK_STATS_HPP
+
+#include <cstddef>
+
+namespace boost {
+namespace arena {
+
+/**
+ * \brief a snapshot of the allocation statistics of an obstack
+ *
+ * Counters are cumulative since construction, gauges describe the current state.
+ * Without a counting stats policy only size and capacity are filled in.
+ */
+struct obstack_stats {
+	///gauge: bytes allocated, this is basic_obstack::size()
+	std::size_t size;
+	///gauge: bytes available in total, this is basic_obstack::capacity()
+	std::size_t capacity;
+	///gauge: the largest size ever reached
+	std::size_t peak_size;
+	///gauge: chunks on the stack, live and blocked
+	std::size_t chunks;
+	///gauge: chunks that are destructed but whose memory is blocked by chunks above them
+	std::size_t blocked_chunks;
+
+	///counter: chunks allocated
+	std::size_t allocations;
+	///counter: calls to dealloc
+	std::size_t deallocations;
+	///counter: calls to dealloc for objects that were not on the top of the stack
+	std::size_t out_of_order_deallocations;
+	///counter: bytes requested for objects and arrays
+	std::size_t payload_bytes;
+	///counter: bytes spent on alignment padding
+	std::size_t padding_bytes;
+	///counter: bytes spent on chunk headers and array element counts
+	std::size_t header_bytes;
+	///counter: allocations placed into holes of out of order deallocations, see hole_reuse
+	std::size_t hole_reuses;
+
+	obstack_stats() :
+		size(0),
+		capacity(0),
+		peak_size(0),
+		chunks(0),
+		blocked_chunks(0),
+		allocations(0),
+		deallocations(0),
+		out_of_order_deallocations(0),
+		payload_bytes(0),
+		padding_bytes(0),
+		header_bytes(0),
+		hole_reuses(0)
+	{}
+};
+
+/**
+ * \brief the default stats policy of basic_obstack: count nothing
+ *
+ * A stats policy is a base class of basic_obstack which gets notified about
+ * allocations and deallocations. All hooks of null_stats are empty
+ * and inline, so a basic_obstack without statistics has no overhead.
+ */
+struct null_stats {
+	///when false, the obstack does not walk chunks just to report reclaims on rewind
+	enum { tracks_chunks = 0 };
+
+	///a chunk for obj was allocated, size is the size of the obstack after the allocation
+	void on_allocate(const void * /*obj*/, std::size_t /*align_to*/, std::size_t /*padding*/, std::size_t /*header*/, std::size_t /*payload*/, std::size_t /*size*/) {}
+	///dealloc was called for an object on the top of the stack or not
+	void on_dealloc(const void * /*obj*/, bool /*on_top*/) {}
+	///a chunk was marked as destructed
+	void on_destruct() {}
+	///a blocked chunk was reused for an allocation of payload bytes at obj
+	void on_reuse(const void * /*obj*/, std::size_t /*align_to*/, std::size_t /*payload*/) {}
+	///the array obj on the top of the stack was resized in place from old_payload to new_payload bytes, size is the size of the obstack after the resize
+	void on_resize(const void * /*obj*/, std::size_t /*old_payload*/, std::size_t /*new_payload*/, std::size_t /*size*/) {}
+	///the memory of the chunk of obj was reclaimed
+	void on_reclaim(const void * /*obj*/, bool /*was_destructed*/) {}
+	///the chunk of obj on the top of the stack was taken back because its constructor threw
+	void on_unallocate(const void * /*obj*/) {}
+	///the obstack is rewound to a marker taken at the given size
+	void on_rewind(std::size_t /*size*/) {}
+	///all chunks were reclaimed at once
+	void on_reset() {}
+
+	void fill(obstack_stats &) const {}
+};
+
+/**
+ * \brief a stats policy that counts everything in obstack_stats
+ */
+class counting_stats {
+public:
+	enum { tracks_chunks = 1 };
+
+	void on_allocate(const void * /*obj*/, std::size_t /*align_to*/, std::size_t const padding, std::size_t const header, std::size_t const payload, std::size_t const size) {
+		counts.allocations++;
+		counts.chunks++;
+		counts.padding_bytes += padding;
+		counts.header_bytes += header;
+		counts.payload_bytes += payload;
+		if(size > counts.peak_size) {
+			counts.peak_size = size;
+		}
+	}
+
+	void on_dealloc(const void * /*obj*/, bool const on_top) {
+		counts.deallocations++;
+		if(!on_top) {
+			counts.out_of_order_deallocations++;
+		}
+	}
+
+	void on_destruct() {
+		counts.blocked_chunks++;
+	}
+
+	void on_reuse(const void * /*obj*/, std::size_t /*align_to*/, std::size_t const payload) {
+		counts.allocations++;
+		counts.hole_reuses++;
+		counts.blocked_chunks--;
+		counts.payload_bytes += payload;
+	}
+
+	void on_resize(const void * /*obj*/, std::size_t const old_payload, std::size_t const new_payload, std::size_t const size) {
+		if(new_payload > old_payload) {
+			counts.payload_bytes += new_payload - old_payload;
+		}
+		if(size > counts.peak_size) {
+			counts.peak_size = size;
+		}
+	}
+
+	void on_reclaim(const void * /*obj*/, bool const was_destructed) {
+		counts.chunks--;
+		if(was_destructed) {
+			counts.blocked_chunks--;
+		}
+	}
+
+	void on_unallocate(const void * /*obj*/) {
+		counts.chunks--;
+	}
+
+	void on_rewind(std::size_t /*size*/) {}
+
+	void on_reset() {
+		counts.chunks = 0;
+		counts.blocked_chunks = 0;
+	}
+
+	void fill(obstack_stats &s) const {
+		const std::size_t size = s.size;
+		const std::size_t capacity = s.capacity;
+		s = counts;
+		s.size = size;
+		s.capacity = capacity;
+	}
+
+private:
+	obstack_stats counts;
+};
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_OBSTACK_STATS_HPP
@@ -0,0 +1,183 @@
+#ifndef BOOST_ARENA_OBSTACK_TRACE_HPP
+#define BOOST_ARENA_OBSTACK_TRACE_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include <time.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+
+#include "obstack_stats.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \brief one recorded operation of an obstack, 32 bytes in the trace
+ *
+ * Objects are identified by their address. Sizes above 4GB are saturated.
+ */
+struct trace_event {
+	enum kind_type {
+		///an object of size bytes with alignment align was allocated on top of the stack at position
+		allocate = 0,
+		///an object of size bytes was placed into a hole, see hole_reuse
+		reuse = 1,
+		///the object was deallocated from the top of the stack
+		dealloc_top = 2,
+		///the object was deallocated out of order
+		dealloc = 3,
+		///the allocation was taken back because the constructor threw
+		unallocate = 4,
+		///the obstack was rewound to a marker taken at position
+		rewind = 5,
+		///all objects were deallocated
+		reset = 6
+	};
+
+	///CLOCK_MONOTONIC time in ns
+	boost::uint64_t timestamp;
+	///address of the object
+	boost::uint64_t object;
+	///the size of the obstack before the allocation, or the marker size of a rewind
+	boost::uint64_t position;
+	boost::uint32_t size;
+	boost::uint16_t align;
+	boost::uint8_t kind;
+	boost::uint8_t reserved;
+};
+
+BOOST_STATIC_ASSERT_MSG(sizeof(trace_event) == 32, "trace_event is not packed");
+
+/**
+ * \brief a stats policy that records every operation of an obstack into a ring buffer
+ *
+ * The last N events are kept inside the obstack object, older ones are
+ * overwritten. Read them with basic_obstack::get_stats_policy() and save
+ * them with write_trace. Like every stats policy it is compiled out
+ * unless an obstack is instantiated with it.
+ *
+ * Tracing reads the clock on every operation, so it is meant for
+ * recording allocation patterns, not for production builds.
+ */
+template<std::size_t N = 1024>
+class trace_stats {
+public:
+	enum { tracks_chunks = 0 };
+	enum { capacity = N };
+
+	trace_stats() : num_events(0) {}
+
+	void on_allocate(const void * const obj, std::size_t const align_to, std::size_t const padding, std::size_t const header, std::size_t const payload, std::size_t const size) {
+		record(trace_event::allocate, obj, payload, align_to, size - padding - header - payload);
+	}
+	void on_dealloc(const void * const obj, bool const on_top) {
+		record(on_top ? trace_event::dealloc_top : trace_event::dealloc, obj, 0, 0, 0);
+	}
+	void on_destruct() {}
+	void on_reuse(const void * const obj, std::size_t const align_to, std::size_t const payload) {
+		record(trace_event::reuse, obj, payload, align_to, 0);
+	}
+	void on_resize(const void * /*obj*/, std::size_t /*old_payload*/, std::size_t /*new_payload*/, std::size_t /*size*/) {}
+	//reclaims follow from a dealloc, rewind or reset already in the trace
+	void on_reclaim(const void * /*obj*/, bool /*was_destructed*/) {}
+	void on_unallocate(const void * const obj) {
+		record(trace_event::unallocate, obj, 0, 0, 0);
+	}
+	void on_rewind(std::size_t const size) {
+		record(trace_event::rewind, NULL, 0, 0, size);
+	}
+	void on_reset() {
+		record(trace_event::reset, NULL, 0, 0, 0);
+	}
+
+	void fill(obstack_stats &) const {}
+
+	///the number of events recorded since construction, including overwritten ones
+	std::size_t recorded() const { return num_events; }
+	///the number of events in the ring buffer
+	std::size_t size() const { return num_events < N ? num_events : N; }
+	///the events in the ring buffer, 0 is the oldest
+	const trace_event& operator[](std::size_t const i) const {
+		return events[(num_events - size() + i) % N];
+	}
+
+private:
+	static boost::uint64_t now() {
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<boost::uint64_t>(ts.tv_sec)*1000000000u + static_cast<boost::uint64_t>(ts.tv_nsec);
+	}
+
+	void record(trace_event::kind_type const kind, const void * const obj, std::size_t const size, std::size_t const align, std::size_t const position) {
+		trace_event &e = events[num_events % N];
+		e.timestamp = now();
+		e.object = reinterpret_cast<std::size_t>(obj);
+		e.position = position;
+		e.size = size > 0xffffffffu ? 0xffffffffu : static_cast<boost::uint32_t>(size);
+		e.align = static_cast<boost::uint16_t>(align);
+		e.kind = static_cast<boost::uint8_t>(kind);
+		e.reserved = 0;
+		num_events++;
+	}
+
+	trace_event events[N];
+	std::size_t num_events;
+};
+
+namespace arena_detail {
+	static const char trace_magic[8] = { 'O', 'B', 'S', 'T', 'R', 'C', '0', '1' };
+}
+
+/**
+ * \brief write the events of a trace_stats ring buffer to a binary stream
+ *
+ * The format is an 8 byte magic, a 64 bit event count and the events
+ * in host byte order, oldest first.
+ */
+template<class Trace>
+bool write_trace(std::ostream &out, const Trace &trace) {
+	const boost::uint64_t count = trace.size();
+	out.write(arena_detail::trace_magic, sizeof(arena_detail::trace_magic));
+	out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	for(std::size_t i=0; i<trace.size(); i++) {
+		out.write(reinterpret_cast<const char*>(&trace[i]), sizeof(trace_event));
+	}
+	return out.good();
+}
+
+///read a trace written by write_trace, false if the stream does not hold one
+inline bool read_trace(std::istream &in, std::vector<trace_event> &events) {
+	char magic[sizeof(arena_detail::trace_magic)];
+	boost::uint64_t count = 0;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(&count), sizeof(count));
+	if(!in || std::memcmp(magic, arena_detail::trace_magic, sizeof(magic)) != 0) {
+		return false;
+	}
+	//the count is not trusted, the events are read in bounded steps so a bogus count cannot exhaust memory
+	const std::size_t step = 4096;
+	events.clear();
+	while(events.size() < count) {
+		const std::size_t begin = events.size();
+		const boost::uint64_t left = count - begin;
+		const std::size_t n = left < step ? static_cast<std::size_t>(left) : step;
+		events.resize(begin + n);
+		in.read(reinterpret_cast<char*>(&events[begin]), static_cast<std::streamsize>(n * sizeof(trace_event)));
+		if(in.fail()) {
+			events.resize(begin);
+			return false;
+		}
+	}
+	return true;
+}
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_OBSTACK_TRACE_HPP
@@ -0,0 +1,158 @@
+#ifndef BOOST_ARENA_OBSTACK_VECTOR_HPP
+#define BOOST_ARENA_OBSTACK_VECTOR_HPP
+
+#include <cstddef>
+#include <new>
+
+#include <boost/assert.hpp>
+#include <boost/utility.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \class obstack_vector
+ * \brief A dynamic array that lives on an obstack and grows in place while it is on top
+ *
+ * A std::vector with an obstack_allocator leaves every outgrown buffer
+ * behind until the arena is rewound. An obstack_vector asks the obstack
+ * to extend its buffer in place first, which always works while the buffer
+ * is the top of stack and the block has room. Only otherwise the elements
+ * are copied into a buffer of twice the capacity and the old one is
+ * deallocated, i.e. reclaimed on top, marked as freed or turned into
+ * a hole with the hole_reuse policy.
+ *
+ * Like all objects on an arena, the buffer is reclaimed with the arena:
+ * destructing an obstack_vector only destructs its elements, which is a
+ * no-op for trivially destructible types. Allocation failures are
+ * reported by returning false, the vector stays unchanged in that case.
+ */
+template<typename T, class Arena = obstack>
+class obstack_vector
+	: private noncopyable
+{
+public:
+	typedef Arena arena_type;
+	typedef T value_type;
+	typedef std::size_t size_type;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+
+	explicit obstack_vector(arena_type &arena) :
+		arena(arena),
+		elements(NULL),
+		num_elements(0),
+		num_allocated(0)
+	{}
+
+	~obstack_vector() {
+		destroy_elements(0);
+	}
+
+	///make room for at least new_capacity elements, false if the arena is full
+	bool reserve(size_type const new_capacity) {
+		if(new_capacity <= num_allocated) {
+			return true;
+		}
+		if(elements && arena.try_extend(reinterpret_cast<unsigned char*>(elements), new_capacity*sizeof(T))) {
+			num_allocated = new_capacity;
+			return true;
+		}
+		return reallocate(new_capacity);
+	}
+
+	///append a copy of value, false if the arena is full
+	bool push_back(const T &value) {
+		if(num_elements == num_allocated && !reserve(num_allocated ? 2*num_allocated : initial_capacity)) {
+			return false;
+		}
+		new(elements + num_elements) T(value);
+		num_elements++;
+		return true;
+	}
+
+	void pop_back() {
+		BOOST_ASSERT_MSG(num_elements, "pop_back on an empty obstack_vector");
+		num_elements--;
+		elements[num_elements].~T();
+	}
+
+	///destruct all elements, the buffer is kept
+	void clear() { destroy_elements(0); }
+
+	T& operator[](size_type const i) { return elements[i]; }
+	const T& operator[](size_type const i) const { return elements[i]; }
+	T& front() { return elements[0]; }
+	const T& front() const { return elements[0]; }
+	T& back() { return elements[num_elements-1]; }
+	const T& back() const { return elements[num_elements-1]; }
+
+	T* data() { return elements; }
+	const T* data() const { return elements; }
+	iterator begin() { return elements; }
+	iterator end() { return elements + num_elements; }
+	const_iterator begin() const { return elements; }
+	const_iterator end() const { return elements + num_elements; }
+
+	size_type size() const { return num_elements; }
+	size_type capacity() const { return num_allocated; }
+	bool empty() const { return num_elements == 0; }
+
+private:
+	enum { initial_capacity = 8 };
+
+	///copy the elements into a new buffer, then give the old one back to the arena
+	bool reallocate(size_type const new_capacity) {
+		T * const new_elements = arena.template alloc_storage<T>(new_capacity);
+		if(!new_elements) {
+			return false;
+		}
+		size_type i = 0;
+		try {
+			for(; i<num_elements; i++) {
+				new(new_elements + i) T(elements[i]);
+			}
+		} catch(...) {
+			while(i) {
+				i--;
+				new_elements[i].~T();
+			}
+			arena.dealloc(new_elements, new_capacity*sizeof(T));
+			throw;
+		}
+		T * const old_elements = elements;
+		const size_type old_allocated = num_allocated;
+		destroy_elements(0);
+		num_elements = i;
+		elements = new_elements;
+		num_allocated = new_capacity;
+		if(old_elements) {
+			arena.dealloc(old_elements, old_allocated*sizeof(T));
+		}
+		return true;
+	}
+
+	void destroy_elements(size_type const new_size) {
+		if(!has_trivial_destructor<T>::value) {
+			while(num_elements > new_size) {
+				num_elements--;
+				elements[num_elements].~T();
+			}
+		}
+		num_elements = new_size;
+	}
+
+	arena_type &arena;
+	T *elements;
+	size_type num_elements;
+	size_type num_allocated;
+};
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_OBSTACK_VECTOR_HPP
@@ -0,0 +1,412 @@
+#ifndef BOOST_ARENA_PERSISTENT_OBSTACK_HPP
+#define BOOST_ARENA_PERSISTENT_OBSTACK_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/assert.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/utility.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/type_traits/is_pod.hpp>
+
+#include "obstack.hpp"
+#include "max_alignment_type.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \class persistent_obstack
+ * \brief A relocatable obstack for POD types that lives in a file or a memory image
+ *
+ * A persistent_obstack stores nothing but offsets from the start of its memory:
+ * the image header, the chunk_headers and the top of stack are offsets,
+ * there are no absolute pointers and no destructor pointers. Therefore the
+ * whole arena can be mapped from a file, written back, copied or mapped at
+ * another address and used again without any deserialization.
+ *
+ * Only POD types can be allocated. Objects that point to each other must do so
+ * with offsets (see to_offset and from_offset) or with self-relative pointers
+ * like boost::interprocess::offset_ptr. The root object, e.g. the entry point
+ * of a prebuilt index, is found again with set_root and root.
+ *
+ * The memory layout looks like this:
+ *
+ *               |padding         |padding
+ * |image_header ||chunk_header ||chunk_header |
+ * |             ||  | object   ||  | object   |
+ * ____________________________________________..._____
+ * |             ||  |          ||  |          |       |
+ * --------------------------------------------...-----
+ * ^                             ^             ^       ^
+ * 0                             top           used    capacity
+ *
+ * Like an obstack, objects can be deallocated in any order, their memory is
+ * reclaimed once everything above them is deallocated.
+ * The arena does not grow, allocations return NULL when it is full.
+ */
+class persistent_obstack
+	: private noncopyable
+{
+public:
+	typedef std::size_t size_type;
+	typedef char byte_type;
+	///an offset from the start of the arena, 0 is never an object
+	typedef boost::uint64_t offset_type;
+
+	enum open_mode {
+		///format a new, empty arena, an existing file is overwritten
+		create,
+		///use the arena that is already in the file or memory image
+		open_existing
+	};
+
+	/**
+	 * \brief a saved top of stack position, see mark() and rewind_to()
+	 *
+	 * Markers are offsets as well and stay valid when the arena is reopened.
+	 */
+	class marker {
+	public:
+		marker() : used(0), top(0) {}
+	private:
+		friend class persistent_obstack;
+		marker(offset_type const used, offset_type const top) : used(used), top(top) {}
+		offset_type used;
+		offset_type top;
+	};
+
+	/**
+	 * \brief map the arena from a file
+	 *
+	 * With create, the file is truncated to capacity bytes and formatted.
+	 * With open_existing, capacity is ignored and the file is mapped as it is,
+	 * nothing is read or copied. Throws std::runtime_error when the file cannot
+	 * be opened or mapped, or does not contain a persistent_obstack.
+	 */
+	persistent_obstack(const char * const path, open_mode const mode, size_type const capacity = 0) :
+		mem(NULL),
+		fd(-1),
+		mapped_size(0)
+	{
+		fd = ::open(path, mode == create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0644);
+		if(fd < 0) {
+			fail("cannot open ", path);
+		}
+		size_type mapping_size = capacity;
+		if(mode == create) {
+			if(capacity < min_capacity() || ftruncate(fd, static_cast<off_t>(capacity)) != 0) {
+				::close(fd);
+				fail("cannot resize ", path);
+			}
+		} else {
+			struct stat st;
+			if(fstat(fd, &st) != 0 || static_cast<size_type>(st.st_size) < min_capacity()) {
+				::close(fd);
+				fail("not a persistent_obstack: ", path);
+			}
+			mapping_size = static_cast<size_type>(st.st_size);
+		}
+		void * const p = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(p == MAP_FAILED) {
+			::close(fd);
+			fail("cannot map ", path);
+		}
+		mem = static_cast<byte_type*>(p);
+		mapped_size = mapping_size;
+		if(mode == create) {
+			format(mapping_size);
+		} else if(!is_image(mem, mapping_size)) {
+			unmap();
+			fail("not a persistent_obstack: ", path);
+		}
+	}
+
+	/**
+	 * \brief use a memory image, e.g. a copy of an arena file or a shared memory segment
+	 *
+	 * The memory is not owned by the persistent_obstack.
+	 * With open_existing, the image must hold a persistent_obstack of image_size bytes.
+	 */
+	persistent_obstack(max_align_t * const image, size_type const image_size, open_mode const mode) :
+		mem(reinterpret_cast<byte_type*>(image)),
+		fd(-1),
+		mapped_size(0)
+	{
+		BOOST_ASSERT_MSG(image, "supplied image is NULL");
+		BOOST_ASSERT_MSG(image_size >= min_capacity(), "supplied image is too small");
+		if(mode == create) {
+			format(image_size);
+		} else if(!is_image(mem, image_size)) {
+			boost::throw_exception(std::runtime_error("not a persistent_obstack image"));
+		}
+	}
+
+	/**
+	 * \brief unmap the file
+	 *
+	 * The kernel writes the pages back eventually, call flush()
+	 * to be sure that the file is complete.
+	 */
+	~persistent_obstack() {
+		if(fd >= 0) {
+			unmap();
+		}
+	}
+
+	/**
+	 * \brief Allocate and construct an object of POD type T
+	 *
+	 * With C++11 the arguments are perfectly forwarded to the constructor of T,
+	 * otherwise at most one const argument is supported.
+	 */
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+	template<typename T, typename... Args>
+	T* alloc(Args&&... args) {
+		BOOST_STATIC_ASSERT_MSG( is_pod<T>::value, "T must be a POD type.");
+		byte_type * const p = allocate(alignment_of<T>::value, sizeof(T));
+		return p ? new(p) T(std::forward<Args>(args)...) : NULL;
+	}
+#else
+	template<typename T>
+	T* alloc() {
+		BOOST_STATIC_ASSERT_MSG( is_pod<T>::value, "T must be a POD type.");
+		byte_type * const p = allocate(alignment_of<T>::value, sizeof(T));
+		return p ? new(p) T() : NULL;
+	}
+	template<typename T, typename T1>
+	T* alloc(const T1 &a1) {
+		BOOST_STATIC_ASSERT_MSG( is_pod<T>::value, "T must be a POD type.");
+		byte_type * const p = allocate(alignment_of<T>::value, sizeof(T));
+		return p ? new(p) T(a1) : NULL;
+	}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+
+	/**
+	 * \brief Allocate a linear packed array of uninitialized elements
+	 *
+	 * T must be a POD type since there is no cunstructor called.
+	 */
+	template<typename T>
+	T* alloc_array(size_type const num_elements) {
+		BOOST_STATIC_ASSERT_MSG( is_pod<T>::value, "T must be a POD type.");
+		return reinterpret_cast<T*>(allocate(alignment_of<T>::value, sizeof(T)*num_elements));
+	}
+
+	/**
+	 * \brief deallocate an object and reclaim memory if possible
+	 *
+	 * The memory of an object that is not on the top of the stack
+	 * is reclaimed when everything above it is deallocated.
+	 */
+	void dealloc(void * const obj) {
+		if(obj) {
+			BOOST_ASSERT_MSG(is_valid(obj), "invalid deallocation detected");
+			chunk_header * const chead = to_chunk_header(obj);
+			chead->size |= free_flag;
+			deallocate_as_possible();
+		}
+	}
+
+	///deallocate all objects, the root is reset as well
+	void dealloc_all() {
+		header().used = first_chunk_offset();
+		header().top = 0;
+		header().root = 0;
+	}
+
+	///save the current top of stack
+	marker mark() const { return marker(header().used, header().top); }
+
+	///free all objects allocated after the marker has been taken
+	void rewind_to(const marker &m) {
+		BOOST_ASSERT_MSG(m.used, "rewind to an empty marker");
+		BOOST_ASSERT_MSG(m.used <= header().used, "rewind to an invalid marker");
+		header().used = m.used;
+		header().top = m.top;
+		deallocate_as_possible();
+	}
+
+	///the offset of p from the start of the arena, 0 for NULL
+	offset_type to_offset(const void * const p) const {
+		return p ? static_cast<offset_type>(static_cast<const byte_type*>(p) - mem) : 0;
+	}
+
+	///the object at an offset returned by to_offset in this or an earlier mapping of the arena
+	template<typename T>
+	T* from_offset(offset_type const offset) const {
+		return offset ? reinterpret_cast<T*>(mem + offset) : NULL;
+	}
+
+	///remember the entry point of the data in the arena
+	void set_root(const void * const obj) {
+		BOOST_ASSERT_MSG(!obj || is_valid(obj), "root is not an object in this arena");
+		header().root = to_offset(obj);
+	}
+
+	///the object passed to set_root, NULL if there is none
+	template<typename T>
+	T* root() const { return from_offset<T>(header().root); }
+
+	/**
+	 * \brief check if a given pointer is a valid pointer to an object in this arena
+	 *
+	 * The check only uses offsets: the chunk_header must be inside the used
+	 * memory, point to a chunk below it and its object must fit below the top of stack.
+	 * Unlike obstack::is_valid there is no checksum, so this catches stray
+	 * pointers in most but not all cases.
+	 */
+	bool is_valid(const void * const obj) const {
+		const byte_type * const p = static_cast<const byte_type*>(obj);
+		if(p < mem + first_chunk_offset() + sizeof(chunk_header) || p >= mem + header().used) {
+			return false;
+		}
+		const offset_type chunk = to_offset(p) - sizeof(chunk_header);
+		//chunk_headers are aligned, do not read a misaligned one
+		if(chunk % alignment_of<chunk_header>::value != 0) {
+			return false;
+		}
+		const chunk_header * const chead = to_chunk_header(obj);
+		//only the bottom chunk has no prev, it is at the start up to the alignment padding
+		const bool prev_ok = chead->prev ?
+			chead->prev >= first_chunk_offset() && chead->prev < chunk :
+			chunk < first_chunk_offset() + alignment_of<max_align_t>::value;
+		return prev_ok && to_offset(p) + (chead->size >> 1) <= header().used;
+	}
+
+	///write all changes back to the file, does nothing for memory images
+	bool flush() {
+		return fd < 0 || msync(mem, capacity(), MS_SYNC) == 0;
+	}
+
+	///get the number of bytes that are already allocated, including the image header
+	size_type size() const { return static_cast<size_type>(header().used); }
+	///get the number of bytes of the arena in total
+	size_type capacity() const { return static_cast<size_type>(header().capacity); }
+
+	///the start of the arena, all offsets are relative to it
+	const void* data() const { return mem; }
+
+	///the smallest arena that can hold anything
+	static size_type min_capacity() { return first_chunk_offset() + sizeof(chunk_header) + sizeof(max_align_t); }
+
+private:
+	struct image_header {
+		char magic[8];
+		offset_type capacity;
+		///the top of stack
+		offset_type used;
+		///the topmost chunk_header, 0 if there is none
+		offset_type top;
+		///the offset of the root object, 0 if there is none
+		offset_type root;
+	};
+
+	struct chunk_header {
+		///the offset of the chunk_header below, 0 if there is none
+		offset_type prev;
+		///size of the object shifted left by one, the lowest bit is the free_flag
+		offset_type size;
+	};
+
+	enum { free_flag = 1 };
+
+	static const char* magic() { return "OBSPRS01"; }
+
+	static size_type first_chunk_offset() {
+		const size_type align = alignment_of<max_align_t>::value;
+		return (sizeof(image_header) + align - 1) / align * align;
+	}
+
+	image_header& header() { return *reinterpret_cast<image_header*>(mem); }
+	const image_header& header() const { return *reinterpret_cast<const image_header*>(mem); }
+
+	static chunk_header* to_chunk_header(void * const obj) {
+		return reinterpret_cast<chunk_header*>(static_cast<byte_type*>(obj) - sizeof(chunk_header));
+	}
+	static const chunk_header* to_chunk_header(const void * const obj) {
+		return reinterpret_cast<const chunk_header*>(static_cast<const byte_type*>(obj) - sizeof(chunk_header));
+	}
+	chunk_header* chunk_at(offset_type const offset) {
+		return reinterpret_cast<chunk_header*>(mem + offset);
+	}
+
+	static bool is_image(const byte_type * const mem, size_type const size) {
+		const image_header &h = *reinterpret_cast<const image_header*>(mem);
+		return
+			std::memcmp(h.magic, magic(), sizeof(h.magic)) == 0 &&
+			h.capacity == size &&
+			h.used >= first_chunk_offset() && h.used <= h.capacity &&
+			h.top < h.used;
+	}
+
+	void format(size_type const capacity) {
+		std::memcpy(header().magic, magic(), sizeof(header().magic));
+		header().capacity = capacity;
+		dealloc_all();
+	}
+
+	byte_type* allocate(size_type const align_to, size_type const size) {
+		BOOST_ASSERT_MSG(align_to <= alignment_of<max_align_t>::value, "over-aligned types are not supported");
+		//mem is max aligned, so aligning the offset aligns the object,
+		//and the chunk_header in front of it needs its own alignment as well
+		const offset_type align = align_to > alignment_of<chunk_header>::value ? align_to : alignment_of<chunk_header>::value;
+		const offset_type unaligned = header().used + sizeof(chunk_header);
+		const offset_type obj = unaligned + ((0 - unaligned) & (align - 1));
+		if(obj > header().capacity || size > header().capacity - obj) {
+			return NULL;
+		}
+		const offset_type chunk = obj - sizeof(chunk_header);
+		chunk_header * const chead = chunk_at(chunk);
+		chead->prev = header().top;
+		chead->size = static_cast<offset_type>(size) << 1;
+		header().top = chunk;
+		header().used = obj + size;
+		return mem + obj;
+	}
+
+	/**
+	 * \brief rewind the top of stack over all deallocated chunks on top
+	 *
+	 * complexity: O(k) where k is the number of consecutive deallocated chunks
+	 */
+	void deallocate_as_possible() {
+		while(header().top && (chunk_at(header().top)->size & free_flag)) {
+			const offset_type chunk = header().top;
+			header().top = chunk_at(chunk)->prev;
+			header().used = header().top ? chunk : first_chunk_offset();
+		}
+	}
+
+	void unmap() {
+		munmap(mem, mapped_size);
+		::close(fd);
+		fd = -1;
+	}
+
+	static void fail(const char * const what, const char * const path) {
+		boost::throw_exception(std::runtime_error(std::string(what) + path));
+	}
+
+	byte_type *mem;
+	///the mapped file, -1 for memory images
+	int fd;
+	size_type mapped_size;
+};
+
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_PERSISTENT_OBSTACK_HPP
@@ -0,0 +1,122 @@
+#ifndef BOOST_ARENA_RING_OBSTACK_HPP
+#define BOOST_ARENA_RING_OBSTACK_HPP
+
+#include <cstddef>
+#include <memory>
+
+#include <boost/assert.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/utility.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+#include "max_alignment_type.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \class ring_obstack
+ * \brief N frame obstacks in one allocation that are recycled round robin
+ *
+ * Data of a pipeline stage often lives for a fixed number of frames.
+ * A ring_obstack carves N child obstacks of frame_capacity bytes out of a
+ * single basic_obstack. frame() is the obstack of the current frame,
+ * next_frame() moves on to the oldest one and empties it, so everything
+ * allocated in a frame stays valid for the following N-1 frames and is
+ * released without a single per-object free.
+ *
+ * Emptying a frame is dealloc_all of its child: when a frame holds only
+ * trivially destructible objects, nothing is walked and the reset is O(1).
+ * Frames are fixed-capacity, an allocation that does not fit returns NULL.
+ */
+template<
+	std::size_t N,
+	class A = std::allocator<max_align_t>,
+	class S = null_stats,
+	class P = security::hardened,
+	class H = no_hole_reuse
+>
+class ring_obstack
+	: private noncopyable
+{
+public:
+	typedef basic_obstack<A, S, P, H> parent_type;
+	typedef typename parent_type::child_type frame_type;
+	typedef typename parent_type::size_type size_type;
+	typedef A allocator_type;
+
+	BOOST_STATIC_ASSERT_MSG(N > 0, "a ring_obstack needs at least one frame");
+
+	enum { num_frames = N };
+
+	///reserve N frames of frame_capacity bytes each with a single allocation
+	explicit ring_obstack(size_type const frame_capacity, const allocator_type &a = allocator_type()) :
+		parent(required_capacity(frame_capacity), a),
+		current(0),
+		num_rotations(0)
+	{
+		BOOST_ASSERT_MSG(frame_capacity, "ring_obstack with frame_capacity of 0 requested");
+		for(std::size_t i=0; i<N; i++) {
+			frames[i] = parent.make_child(frame_capacity);
+			BOOST_ASSERT_MSG(frames[i], "frame does not fit into the ring");
+		}
+	}
+
+	///the obstack of the current frame
+	frame_type& frame() { return *frames[current]; }
+	const frame_type& frame() const { return *frames[current]; }
+
+	///the obstack of the frame age frames ago, age 0 is the current frame
+	frame_type& frame(size_type const age) {
+		BOOST_ASSERT_MSG(age < N, "frame is older than the ring");
+		return *frames[(current + N - age) % N];
+	}
+
+	/**
+	 * \brief start a new frame in the obstack of the oldest one
+	 *
+	 * All objects of the oldest frame are destructed and its memory is reclaimed.
+	 * When a destructor throws, the frame is still emptied and the ring has
+	 * moved on, then the first exception is rethrown.
+	 *
+	 * complexity: O(k) where k is the number of objects with non-trivial
+	 * destructors in the oldest frame, O(1) when there are none
+	 */
+	void next_frame() {
+		current = (current + 1) % N;
+		num_rotations++;
+		frames[current]->dealloc_all();
+	}
+
+	///the number of next_frame calls since construction
+	size_type frame_number() const { return num_rotations; }
+
+	///get the number of bytes allocated in all frames
+	size_type size() const {
+		size_type sum = 0;
+		for(std::size_t i=0; i<N; i++) {
+			sum += frames[i]->size();
+		}
+		return sum;
+	}
+
+private:
+	///the parent capacity that fits N children with their chunk_headers and padding
+	static size_type required_capacity(size_type const frame_capacity) {
+		const size_type align = sizeof(max_align_t);
+		const size_type rounded_capacity = (frame_capacity + align - 1) / align * align;
+		const size_type head = (sizeof(frame_type) + align - 1) / align * align;
+		return N*(head + rounded_capacity) + parent_type::max_overhead(N) + align;
+	}
+
+	parent_type parent;
+	frame_type *frames[N];
+	std::size_t current;
+	size_type num_rotations;
+};
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_RING_OBSTACK_HPP
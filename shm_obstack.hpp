@@ -0,0 +1,324 @@
+#ifndef BOOST_ARENA_SHM_OBSTACK_HPP
+#define BOOST_ARENA_SHM_OBSTACK_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/assert.hpp>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/utility.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+#include "obstack.hpp"
+#include "max_alignment_type.hpp"
+#include "null_allocator.hpp"
+
+namespace boost {
+namespace arena {
+
+/**
+ * \brief a POSIX shared memory segment mapped into this process
+ *
+ * The segment stays in the system until remove() is called,
+ * the destructor only unmaps it. Link with -lrt on older systems.
+ */
+class shared_memory_segment
+	: private noncopyable
+{
+public:
+	typedef std::size_t size_type;
+
+	enum open_mode {
+		///create the segment with size bytes, an existing one is truncated
+		create,
+		///map the segment another process has created, size is ignored
+		open_existing
+	};
+
+	/**
+	 * \brief open and map a segment, name must start with a slash
+	 *
+	 * Throws std::runtime_error when the segment cannot be opened or mapped.
+	 */
+	shared_memory_segment(const char * const name, open_mode const mode, size_type const size = 0) :
+		mem(NULL),
+		mapped_size(size)
+	{
+		const int fd = shm_open(name, mode == create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0600);
+		if(fd < 0) {
+			fail("cannot open shared memory ", name);
+		}
+		if(mode == create) {
+			if(!size || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+				::close(fd);
+				fail("cannot resize shared memory ", name);
+			}
+		} else {
+			struct stat st;
+			if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+				::close(fd);
+				fail("cannot stat shared memory ", name);
+			}
+			mapped_size = static_cast<size_type>(st.st_size);
+		}
+		void * const p = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if(p == MAP_FAILED) {
+			fail("cannot map shared memory ", name);
+		}
+		mem = static_cast<max_align_t*>(p);
+	}
+
+	~shared_memory_segment() {
+		munmap(mem, mapped_size);
+	}
+
+	///remove the segment from the system, mappings stay valid until they are unmapped
+	static bool remove(const char * const name) {
+		return shm_unlink(name) == 0;
+	}
+
+	max_align_t* data() const { return mem; }
+	size_type size() const { return mapped_size; }
+
+private:
+	static void fail(const char * const what, const char * const name) {
+		boost::throw_exception(std::runtime_error(std::string(what) + name));
+	}
+
+	max_align_t *mem;
+	size_type mapped_size;
+};
+
+namespace arena_detail {
+
+BOOST_STATIC_ASSERT_MSG(BOOST_ATOMIC_INT64_LOCK_FREE == 2, "64 bit atomics in shared memory must be lock-free");
+
+/**
+ * \brief the block at the start of a segment through which writer and reader hand off the top of stack
+ *
+ * Both positions are offsets from the start of the segment.
+ */
+struct shm_control {
+	char magic[8];
+	///everything below is completely written and may be read
+	boost::atomic<boost::uint64_t> published;
+	///everything below is read and may be reclaimed
+	boost::atomic<boost::uint64_t> consumed;
+	///incremented by every reclaim, tells offsets of an earlier round from the current one
+	boost::atomic<boost::uint64_t> epoch;
+
+	static const char* magic_value() { return "OBSSHM01"; }
+	static std::size_t data_offset() {
+		const std::size_t align = alignment_of<max_align_t>::value > 64 ? alignment_of<max_align_t>::value : 64;
+		return (sizeof(shm_control) + align - 1) / align * align;
+	}
+};
+
+} //namespace arena_detail
+
+/**
+ * \class shm_obstack
+ * \brief builds objects in a shared memory segment for another process to read in place
+ *
+ * The arena is an obstack with a null_allocator over the segment, behind a
+ * small control block. Objects are allocated with arena() as usual, then
+ * publish() makes everything allocated so far visible to the
+ * shm_obstack_reader in the other process. Only offsets are passed between
+ * the processes, the reader maps the segment at its own address.
+ *
+ * The chunk_headers hold pointers that are only meaningful in the writing
+ * process, the reader never sees them and never calls destructors.
+ * Messages should therefore be PODs that refer to each other by offset.
+ *
+ * There is exactly one writer and one reader. When the reader has released
+ * everything that was published, reclaim() resets the arena for the next messages.
+ */
+class shm_obstack
+	: private noncopyable
+{
+public:
+	typedef basic_obstack<null_allocator<max_align_t> > arena_type;
+	typedef arena_type::size_type size_type;
+	///an offset from the start of the segment
+	typedef boost::uint64_t offset_type;
+
+	/**
+	 * \brief format the segment, previous contents are lost
+	 *
+	 * Throws std::runtime_error when the segment has no room behind the control block.
+	 */
+	explicit shm_obstack(shared_memory_segment &segment) :
+		segment(segment),
+		control(format(segment)),
+		memory(
+			reinterpret_cast<max_align_t*>(reinterpret_cast<char*>(segment.data()) + arena_detail::shm_control::data_offset()),
+			segment.size() - arena_detail::shm_control::data_offset(),
+			null_allocator<max_align_t>()
+		)
+	{
+		std::memcpy(control->magic, arena_detail::shm_control::magic_value(), sizeof(control->magic));
+		control->epoch.store(0, boost::memory_order_relaxed);
+		control->published.store(arena_detail::shm_control::data_offset(), boost::memory_order_relaxed);
+		control->consumed.store(arena_detail::shm_control::data_offset(), boost::memory_order_release);
+	}
+
+	///the obstack in the segment, for allocating messages
+	arena_type& arena() { return memory; }
+
+	///the offset of an object in the segment, this is what is passed to the reader
+	offset_type offset_of(const void * const obj) const {
+		return static_cast<offset_type>(static_cast<const char*>(obj) - reinterpret_cast<const char*>(segment.data()));
+	}
+
+	/**
+	 * \brief check that offset is a published object of this arena
+	 *
+	 * The offset must be inside the published part of the segment and
+	 * the chunk_header in front of it must pass obstack::is_valid.
+	 * Objects on an obstack are at least aligned like the pointers in their
+	 * chunk_header, so misaligned offsets are rejected before it is read.
+	 */
+	bool is_valid(offset_type const offset) const {
+		return
+			offset >= arena_detail::shm_control::data_offset() &&
+			offset < control->published.load(boost::memory_order_relaxed) &&
+			offset % alignment_of<void*>::value == 0 &&
+			memory.is_valid(reinterpret_cast<const char*>(segment.data()) + offset);
+	}
+
+	/**
+	 * \brief make all objects allocated so far visible to the reader
+	 *
+	 * All writes to the objects happen before the reader sees the new end.
+	 * Returns the published end offset.
+	 */
+	offset_type publish() {
+		const offset_type end = arena_detail::shm_control::data_offset() + memory.size();
+		control->published.store(end, boost::memory_order_release);
+		return end;
+	}
+
+	/**
+	 * \brief reset the arena if the reader has released everything that was published
+	 *
+	 * Starts a new epoch, the reader rejects offsets of the previous one.
+	 *
+	 * complexity: O(k) where k is the number of objects with non-trivial destructors
+	 */
+	bool reclaim() {
+		const offset_type published = control->published.load(boost::memory_order_relaxed);
+		if(control->consumed.load(boost::memory_order_acquire) < published) {
+			return false;
+		}
+		memory.dealloc_all();
+		control->epoch.fetch_add(1, boost::memory_order_release);
+		control->consumed.store(arena_detail::shm_control::data_offset(), boost::memory_order_relaxed);
+		control->published.store(arena_detail::shm_control::data_offset(), boost::memory_order_release);
+		return true;
+	}
+
+	///the number of reclaims since the segment was formatted
+	boost::uint64_t epoch() const { return control->epoch.load(boost::memory_order_relaxed); }
+
+private:
+	///check that segment fits a control block and some data, then place the control block
+	static arena_detail::shm_control* format(shared_memory_segment &segment) {
+		if(segment.size() <= arena_detail::shm_control::data_offset()) {
+			boost::throw_exception(std::runtime_error("shared memory segment too small for a shm_obstack"));
+		}
+		return new(segment.data()) arena_detail::shm_control();
+	}
+
+	shared_memory_segment &segment;
+	arena_detail::shm_control * const control;
+	arena_type memory;
+};
+
+/**
+ * \class shm_obstack_reader
+ * \brief reads objects a shm_obstack in another process has published
+ *
+ * The reader only trusts offsets: an object is handed out when it lies
+ * completely inside the published part of the segment and is aligned.
+ * Offsets belong to the epoch the reader has seen at its last call to
+ * published(). After the writer has reclaimed the arena, they are rejected
+ * until published() is called again for the new epoch.
+ */
+class shm_obstack_reader
+	: private noncopyable
+{
+public:
+	typedef shm_obstack::offset_type offset_type;
+	typedef std::size_t size_type;
+
+	///throws std::runtime_error when the segment holds no shm_obstack
+	explicit shm_obstack_reader(shared_memory_segment &segment) :
+		segment(segment),
+		control(reinterpret_cast<arena_detail::shm_control*>(segment.data())),
+		current_epoch(0)
+	{
+		if(segment.size() <= arena_detail::shm_control::data_offset() ||
+			std::memcmp(control->magic, arena_detail::shm_control::magic_value(), sizeof(control->magic)) != 0) {
+			boost::throw_exception(std::runtime_error("not a shm_obstack segment"));
+		}
+		current_epoch = control->epoch.load(boost::memory_order_acquire);
+	}
+
+	///the end of the published data, everything below it may be read, and move on to the current epoch
+	offset_type published() {
+		//the epoch is loaded first, so a reclaim in between makes the offsets stale instead of the epoch
+		current_epoch = control->epoch.load(boost::memory_order_acquire);
+		return control->published.load(boost::memory_order_acquire);
+	}
+
+	///the epoch offsets are checked against, see published()
+	boost::uint64_t epoch() const { return current_epoch; }
+
+	///whether num_elements Ts at offset are published and aligned
+	template<typename T>
+	bool is_valid(offset_type const offset, size_type const num_elements = 1) const {
+		const offset_type end = control->published.load(boost::memory_order_acquire);
+		return
+			control->epoch.load(boost::memory_order_acquire) == current_epoch &&
+			offset >= arena_detail::shm_control::data_offset() &&
+			offset <= end &&
+			sizeof(T)*num_elements <= end - offset &&
+			offset % alignment_of<T>::value == 0;
+	}
+
+	///the Ts at offset, NULL unless they are valid
+	template<typename T>
+	const T* at(offset_type const offset, size_type const num_elements = 1) const {
+		return is_valid<T>(offset, num_elements) ?
+			reinterpret_cast<const T*>(reinterpret_cast<const char*>(segment.data()) + offset) :
+			NULL;
+	}
+
+	///tell the writer that everything below offset is read and can be reclaimed
+	void release(offset_type const offset) {
+		control->consumed.store(offset, boost::memory_order_release);
+	}
+
+private:
+	shared_memory_segment &segment;
+	arena_detail::shm_control * const control;
+	boost::uint64_t current_epoch;
+};
+
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_SHM_OBSTACK_HPP
@@ -0,0 +1,183 @@
+#ifndef BOOST_ARENA_THREAD_LOCAL_OBSTACK_HPP
+#define BOOST_ARENA_THREAD_LOCAL_OBSTACK_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#include <boost/config.hpp>
+#include <boost/atomic.hpp>
+#include <boost/limits.hpp>
+#include <boost/lockfree/stack.hpp>
+#include <boost/static_assert.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+#include "max_alignment_type.hpp"
+
+#ifdef BOOST_NO_CXX11_THREAD_LOCAL
+#error "thread_local_obstack.hpp requires C++11 thread_local support"
+#endif
+
+namespace boost {
+namespace arena {
+namespace arena_detail {
+
+/**
+ * \brief a process-wide lock-free free list of memory blocks of BlockSize bytes
+ *
+ * Blocks are taken from the heap only when the free list is empty
+ * and are never given back until the end of the program.
+ * After warm-up, taking and returning a block is a lock-free pointer pop and push.
+ */
+template<std::size_t BlockSize, class Tag>
+class block_pool
+	: private noncopyable
+{
+public:
+	typedef max_align_t value_type;
+	typedef std::size_t size_type;
+
+	enum { block_count = BlockSize / sizeof(value_type) };
+
+	static block_pool& instance() {
+		static block_pool pool;
+		return pool;
+	}
+
+	value_type* take() {
+		value_type *block = NULL;
+		if(free_blocks.pop(block)) {
+			num_cached--;
+			return block;
+		}
+		return heap.allocate(block_count);
+	}
+
+	void give_back(value_type * const block) {
+		if(free_blocks.push(block)) {
+			num_cached++;
+		} else {
+			heap.deallocate(block, block_count);
+		}
+	}
+
+	///fill the free list with num_blocks blocks from the heap
+	void reserve(size_type const num_blocks) {
+		for(size_type i=0; i<num_blocks; i++) {
+			give_back(heap.allocate(block_count));
+		}
+	}
+
+	///number of blocks waiting in the free list
+	size_type cached_blocks() const { return num_cached; }
+
+private:
+	block_pool() :
+		free_blocks(16),
+		num_cached(0)
+	{}
+
+	~block_pool() {
+		value_type *block = NULL;
+		while(free_blocks.pop(block)) {
+			heap.deallocate(block, block_count);
+		}
+	}
+
+	std::allocator<value_type> heap;
+	boost::lockfree::stack<value_type*> free_blocks;
+	boost::atomic<size_type> num_cached;
+};
+
+} //namespace arena_detail
+
+
+/**
+ * \brief an allocator that serves requests of up to BlockSize bytes from a block_pool
+ *
+ * Larger requests are passed on to the heap.
+ */
+template<std::size_t BlockSize, class Tag = void>
+struct block_pool_allocator {
+	typedef max_align_t       value_type;
+	typedef value_type*       pointer;
+	typedef value_type&       reference;
+	typedef const value_type* const_pointer;
+	typedef const value_type& const_reference;
+	typedef size_t            size_type;
+	typedef ptrdiff_t         difference_type;
+
+	typedef arena_detail::block_pool<BlockSize, Tag> pool_type;
+
+	pointer        address(reference x) const { return &x; }
+	const_pointer  address(const_reference x) const { return &x; }
+	pointer        allocate(size_type n, const void * /*hint*/ = 0) {
+		return n <= pool_type::block_count ? pool_type::instance().take() : std::allocator<value_type>().allocate(n);
+	}
+	void           deallocate(pointer p, size_type n) {
+		if(n <= pool_type::block_count) {
+			pool_type::instance().give_back(p);
+		} else {
+			std::allocator<value_type>().deallocate(p, n);
+		}
+	}
+	size_type      max_size() const throw() { return std::numeric_limits<size_type>::max() / sizeof(value_type); }
+	void           construct(pointer p, const_reference val) { new((void*)p) value_type(val); }
+	void           destroy(pointer /*p*/) {}
+};
+
+
+/**
+ * \class thread_local_obstack
+ * \brief A lazily created obstack per thread with memory recycled between threads
+ *
+ * get() returns the obstack of the calling thread. It is created on the first
+ * call in a thread and destroyed when the thread exits. Its memory comes in
+ * blocks of BlockSize bytes from a process-wide lock-free block_pool:
+ * when the obstack runs full, further blocks of the same size are chained
+ * from the pool, and on thread exit all blocks go back to the pool.
+ * Short-lived worker threads thus only touch the heap during warm-up.
+ *
+ * Use different Tag types to get independent pools for the same BlockSize.
+ */
+template<std::size_t BlockSize = 1024*1024, class Tag = void>
+class thread_local_obstack {
+public:
+	typedef block_pool_allocator<BlockSize, Tag> allocator_type;
+	typedef basic_obstack<allocator_type> obstack_type;
+
+	BOOST_STATIC_ASSERT_MSG(
+		BlockSize >= 2*sizeof(max_align_t) + sizeof(void*)*8,
+		"BlockSize is too small to fit a block header"
+	);
+
+	///the obstack of the calling thread
+	static obstack_type& get() {
+		thread_local obstack_type obs(block_capacity(), block_growth(1, block_capacity()));
+		return obs;
+	}
+
+	///make sure the pool holds at least num_blocks blocks without touching the heap later
+	static void reserve(std::size_t const num_blocks) {
+		allocator_type::pool_type::instance().reserve(num_blocks);
+	}
+
+	///number of blocks currently waiting in the pool
+	static std::size_t cached_blocks() {
+		return allocator_type::pool_type::instance().cached_blocks();
+	}
+
+private:
+	///usable bytes per block, such that chained blocks still fit into a pool block
+	static std::size_t block_capacity() {
+		return
+			allocator_type::pool_type::block_count * sizeof(max_align_t) -
+			arena_detail::block_chain<allocator_type>::block_overhead();
+	}
+};
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_THREAD_LOCAL_OBSTACK_HPP
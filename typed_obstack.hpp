@@ -0,0 +1,332 @@
+#ifndef BOOST_ARENA_TYPED_OBSTACK_HPP
+#define BOOST_ARENA_TYPED_OBSTACK_HPP
+
+#include <cstddef>
+#include <new>
+
+#include <boost/assert.hpp>
+#include <boost/utility.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+
+#include "obstack_fwd.hpp"
+#include "obstack.hpp"
+
+namespace boost {
+namespace arena {
+namespace arena_detail {
+
+///a contiguous run of Ts inside a typed_region
+template<typename T>
+struct typed_segment {
+	typed_segment *next;
+	T *begin;
+	std::size_t size;
+	std::size_t capacity;
+};
+
+/**
+ * \brief the objects of one type in a typed_obstack: a list of segments, each twice as large as the one before
+ *
+ * Segments are never moved, so pointers to the objects stay valid until they are cleared.
+ */
+template<typename T>
+class typed_region {
+public:
+	typedef typed_segment<T> segment_type;
+	typedef std::size_t size_type;
+
+	typed_region() : first(NULL), current(NULL), num_objects(0) {}
+
+	///storage for the next T, taken from parent when all segments are full, NULL if parent is full
+	template<class Obstack>
+	T* next(Obstack &parent, size_type const first_capacity) {
+		if(!current || current->size == current->capacity) {
+			if(current && current->next) {
+				current = current->next;
+			} else if(!push_segment(parent, current ? 2*current->capacity : first_capacity)) {
+				return NULL;
+			}
+		}
+		return current->begin + current->size;
+	}
+
+	///the T returned by next has been constructed
+	void commit() {
+		current->size++;
+		num_objects++;
+	}
+
+	///destruct all objects, the segments are kept for reuse
+	void clear() {
+		if(!has_trivial_destructor<T>::value) {
+			for(segment_type *s = first; s; s = s->next) {
+				while(s->size) {
+					s->size--;
+					s->begin[s->size].~T();
+				}
+			}
+		} else {
+			for(segment_type *s = first; s; s = s->next) {
+				s->size = 0;
+			}
+		}
+		current = first;
+		num_objects = 0;
+	}
+
+	///drop the segments after their memory has been reclaimed, all objects must be cleared
+	void forget() {
+		first = NULL;
+		current = NULL;
+	}
+
+	size_type size() const { return num_objects; }
+
+	template<typename F>
+	F for_each_segment(F f) const {
+		for(const segment_type *s = first; s && s->size; s = s->next) {
+			f(s->begin, s->begin + s->size);
+		}
+		return f;
+	}
+
+private:
+	template<class Obstack>
+	bool push_segment(Obstack &parent, size_type const capacity) {
+		segment_type * const s = parent.template alloc<segment_type>();
+		if(!s) {
+			return false;
+		}
+		T * const storage = parent.template alloc_storage<T>(capacity);
+		if(!storage) {
+			//s is still on top, give it back
+			parent.dealloc(s, sizeof(segment_type));
+			return false;
+		}
+		s->next = NULL;
+		s->begin = storage;
+		s->size = 0;
+		s->capacity = capacity;
+		if(current) {
+			current->next = s;
+		} else {
+			first = s;
+		}
+		current = s;
+		return true;
+	}
+
+	segment_type *first;
+	segment_type *current;
+	size_type num_objects;
+};
+
+///the region of an unused type slot of a typed_obstack
+template<int I>
+struct empty_region {
+	void clear() {}
+	void forget() {}
+};
+
+template<typename T, int I>
+struct region_slot {
+	typedef typed_region<T> type;
+};
+
+template<int I>
+struct region_slot<void, I> {
+	typedef empty_region<I> type;
+};
+
+///applies a function to every object of a segment
+template<typename T, typename F>
+struct each_object {
+	explicit each_object(F f) : f(f) {}
+	void operator()(T * const begin, T * const end) {
+		for(T *p = begin; p != end; ++p) {
+			f(*p);
+		}
+	}
+	F f;
+};
+
+} //namespace arena_detail
+
+/**
+ * \class typed_obstack
+ * \brief an arena that keeps the objects of each of up to 8 types in contiguous runs
+ *
+ * In an obstack, objects of different types are interleaved with their
+ * chunk_headers, so a scan over all objects of one type touches widely
+ * spaced memory. A typed_obstack keeps a separate bump region per
+ * registered type instead: the Ts are packed without headers into segments
+ * that double in size, and all segments come from one chained basic_obstack.
+ *
+ * Objects are never moved, so pointers stay stable. for_each visits all
+ * objects of a type in allocation order, for_each_segment hands out the
+ * contiguous [begin, end) ranges for vectorized scans. Like in an arena,
+ * there are no single frees: clear<T>() destructs the objects of one type
+ * and keeps the segments for reuse, dealloc_all() releases everything.
+ *
+ * Only registered types can be allocated, anything else does not compile.
+ * Destructors must not throw.
+ */
+template<
+	class T1,
+	class T2 = void,
+	class T3 = void,
+	class T4 = void,
+	class T5 = void,
+	class T6 = void,
+	class T7 = void,
+	class T8 = void
+>
+class typed_obstack
+	: private noncopyable,
+	  private arena_detail::region_slot<T1, 1>::type,
+	  private arena_detail::region_slot<T2, 2>::type,
+	  private arena_detail::region_slot<T3, 3>::type,
+	  private arena_detail::region_slot<T4, 4>::type,
+	  private arena_detail::region_slot<T5, 5>::type,
+	  private arena_detail::region_slot<T6, 6>::type,
+	  private arena_detail::region_slot<T7, 7>::type,
+	  private arena_detail::region_slot<T8, 8>::type
+{
+public:
+	typedef basic_obstack<> obstack_type;
+	typedef obstack_type::size_type size_type;
+
+	/**
+	 * \brief an arena with an initial block of capacity bytes that chains more blocks on demand
+	 *
+	 * The first segment of every type holds first_segment_size objects.
+	 */
+	explicit typed_obstack(size_type const capacity, size_type const first_segment_size = 64) :
+		memory(capacity, block_growth()),
+		first_segment_size(first_segment_size)
+	{
+		BOOST_ASSERT_MSG(first_segment_size, "typed_obstack with a first_segment_size of 0 requested");
+	}
+
+	~typed_obstack() {
+		clear_all();
+	}
+
+	/**
+	 * \brief Allocate a T in the region of T
+	 *
+	 * Returns NULL when the underlying obstack cannot grow any more.
+	 * When the constructor throws, nothing is allocated.
+	 */
+#ifdef BOOST_ARENA_HAS_VARIADIC_ALLOC
+	template<typename T, typename... Args>
+	T* alloc(Args&&... args) {
+		arena_detail::typed_region<T> &r = region<T>();
+		T * const p = r.next(memory, first_segment_size);
+		if(!p) {
+			return NULL;
+		}
+		new(p) T(std::forward<Args>(args)...);
+		r.commit();
+		return p;
+	}
+#else
+	template<typename T>
+	T* alloc() {
+		arena_detail::typed_region<T> &r = region<T>();
+		T * const p = r.next(memory, first_segment_size);
+		if(!p) {
+			return NULL;
+		}
+		new(p) T();
+		r.commit();
+		return p;
+	}
+	template<typename T, typename A1>
+	T* alloc(const A1 &a1) {
+		arena_detail::typed_region<T> &r = region<T>();
+		T * const p = r.next(memory, first_segment_size);
+		if(!p) {
+			return NULL;
+		}
+		new(p) T(a1);
+		r.commit();
+		return p;
+	}
+#endif //BOOST_ARENA_HAS_VARIADIC_ALLOC
+
+	///the number of live Ts
+	template<typename T>
+	size_type count() const { return region<T>().size(); }
+
+	///call f with every T in allocation order
+	template<typename T, typename F>
+	F for_each(F f) const {
+		return region<T>().for_each_segment(arena_detail::each_object<T, F>(f)).f;
+	}
+
+	///call f(begin, end) with every contiguous range of Ts in allocation order
+	template<typename T, typename F>
+	F for_each_segment(F f) const {
+		return region<T>().for_each_segment(f);
+	}
+
+	/**
+	 * \brief destruct all Ts, their segments are reused by later allocations of T
+	 *
+	 * complexity: O(n) for n Ts with non-trivial destructors, otherwise O(s) for s segments
+	 */
+	template<typename T>
+	void clear() { region<T>().clear(); }
+
+	///destruct the objects of all types and reclaim all memory
+	void dealloc_all() {
+		clear_all();
+		forget_all();
+		memory.dealloc_all();
+	}
+
+	///get the number of bytes allocated for segments in the underlying obstack
+	size_type size() const { return memory.size(); }
+	///get the number of bytes available in the underlying obstack
+	size_type capacity() const { return memory.capacity(); }
+
+private:
+	template<typename T>
+	arena_detail::typed_region<T>& region() { return *this; }
+	template<typename T>
+	const arena_detail::typed_region<T>& region() const { return *this; }
+
+	template<typename T, int I>
+	typename arena_detail::region_slot<T, I>::type& slot() { return *this; }
+
+	void clear_all() {
+		slot<T1, 1>().clear();
+		slot<T2, 2>().clear();
+		slot<T3, 3>().clear();
+		slot<T4, 4>().clear();
+		slot<T5, 5>().clear();
+		slot<T6, 6>().clear();
+		slot<T7, 7>().clear();
+		slot<T8, 8>().clear();
+	}
+
+	void forget_all() {
+		slot<T1, 1>().forget();
+		slot<T2, 2>().forget();
+		slot<T3, 3>().forget();
+		slot<T4, 4>().forget();
+		slot<T5, 5>().forget();
+		slot<T6, 6>().forget();
+		slot<T7, 7>().forget();
+		slot<T8, 8>().forget();
+	}
+
+	obstack_type memory;
+	size_type const first_segment_size;
+};
+
+} //namespace arena
+} //namespace boost
+
+#endif //BOOST_ARENA_TYPED_OBSTACK_HPP